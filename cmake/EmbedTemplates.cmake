@@ -0,0 +1,54 @@
+# Compiles every file below a templates directory into a C++ source, so the executable carries
+# its built-in templates (see src/generator/embedded_templates.hpp).
+# Usage (script mode):
+#   cmake -DTEMPLATES_DIR=<dir> -DOUTPUT=<file.cpp> -P EmbedTemplates.cmake
+# The output is only rewritten when its content changes.
+
+if(NOT TEMPLATES_DIR OR NOT OUTPUT)
+    message(FATAL_ERROR "EmbedTemplates.cmake: TEMPLATES_DIR and OUTPUT are required")
+endif()
+
+file(GLOB_RECURSE _files RELATIVE "${TEMPLATES_DIR}" "${TEMPLATES_DIR}/*")
+list(SORT _files)
+
+set(_data "")
+set(_table "")
+set(_index 0)
+foreach(_name IN LISTS _files)
+    file(READ "${TEMPLATES_DIR}/${_name}" _hex HEX)
+    file(SIZE "${TEMPLATES_DIR}/${_name}" _size)
+    # Two hex digits per byte become "0xNN,"; a trailing NUL keeps empty files valid arrays.
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," _bytes "${_hex}")
+    string(APPEND _data "// ${_name}\nconst unsigned char kTemplate${_index}[] = {${_bytes}0x00};\n\n")
+    string(APPEND _table "    {\"${_name}\", kTemplate${_index}, ${_size}},\n")
+    math(EXPR _index "${_index} + 1")
+endforeach()
+
+if(_index EQUAL 0)
+    message(FATAL_ERROR "EmbedTemplates.cmake: no templates found in ${TEMPLATES_DIR}")
+endif()
+
+set(_source "// Generated by cmake/EmbedTemplates.cmake from templates/. Do not edit.
+#include \"generator/embedded_templates.hpp\"
+
+namespace scaffolder {
+
+namespace {
+
+${_data}}  // namespace
+
+const EmbeddedTemplate kEmbeddedTemplates[] = {
+${_table}};
+
+const size_t kEmbeddedTemplateCount = ${_index};
+
+}  // namespace scaffolder
+")
+
+set(_current "")
+if(EXISTS "${OUTPUT}")
+    file(READ "${OUTPUT}" _current)
+endif()
+if(NOT _current STREQUAL _source)
+    file(WRITE "${OUTPUT}" "${_source}")
+endif()
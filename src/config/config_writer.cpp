@@ -233,4 +233,23 @@ void ConfigWriter::write_dependencies(const std::filesystem::path& folder, const
     write_file(folder / "conanfile.json", j.dump(2));
 }
 
+std::string dump_metadata(const Metadata& m) {
+    json j = {{"schema_version", m.schema_version}, {"env", m.env}};
+    j["project"] = to_json(m.project);
+    auto array_of = [](const auto& items) {
+        json arr = json::array();
+        for (const auto& item : items) arr.push_back(to_json(item));
+        return arr;
+    };
+    j["socs"] = array_of(m.socs);
+    j["boards"] = array_of(m.boards);
+    j["toolchains"] = array_of(m.toolchains);
+    j["isa_variants"] = array_of(m.isa_variants);
+    j["build_variants"] = array_of(m.build_variants);
+    j["components"] = array_of(m.source_tree.components);
+    j["dependencies"] = to_json(m.dependencies);
+    j["preset_matrix"] = to_json(m.preset_matrix);
+    return j.dump();
+}
+
 }  // namespace scaffolder
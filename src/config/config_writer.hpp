@@ -2,6 +2,7 @@
 
 #include "metadata/schema.hpp"
 #include <filesystem>
+#include <string>
 
 namespace scaffolder {
 
@@ -28,4 +29,8 @@ public:
     void write_dependencies(const std::filesystem::path& folder, const Dependencies& d) const;
 };
 
+/** The loaded metadata (after ${VAR} expansion) as compact JSON with sorted keys, so equal metadata
+ *  dumps equally whichever files it was split across. */
+std::string dump_metadata(const Metadata& m);
+
 }  // namespace scaffolder
@@ -0,0 +1,463 @@
+#include "copy/copy_backend.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define SCAFFOLDER_IO_URING 1
+#endif
+#endif
+
+namespace scaffolder {
+
+namespace {
+
+class PortableBackend : public CopyBackend {
+public:
+    void copy(const std::filesystem::path& src, const std::filesystem::path& dest) override {
+        std::filesystem::copy_file(src, dest, std::filesystem::copy_options::overwrite_existing);
+    }
+};
+
+#if defined(__linux__)
+
+[[noreturn]] void throw_errno(const char* what, const std::filesystem::path& p, int err) {
+    throw std::filesystem::filesystem_error(what, p, std::error_code(err, std::generic_category()));
+}
+
+class FileDescriptor {
+public:
+    explicit FileDescriptor(int fd = -1) : fd_(fd) {}
+    ~FileDescriptor() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+    int get() const { return fd_; }
+
+private:
+    int fd_;
+};
+
+bool read_write_copy(int in, int out, off_t offset) {
+    char buf[65536];
+    for (;;) {
+        ssize_t n = ::pread(in, buf, sizeof(buf), offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0) return true;
+        for (ssize_t done = 0; done < n;) {
+            ssize_t w = ::pwrite(out, buf + done, static_cast<size_t>(n - done), offset + done);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            done += w;
+        }
+        offset += n;
+    }
+}
+
+// Copies in to out from byte 0 with copy_file_range, finishing with read/write when the kernel
+// cannot copy between these files (cross-filesystem on old kernels, special filesystems).
+bool copy_contents(int in, int out, off_t size) {
+    off_t offset = 0;
+    while (offset < size) {
+        loff_t in_off = offset;
+        loff_t out_off = offset;
+        ssize_t n = ::copy_file_range(in, &in_off, out, &out_off, static_cast<size_t>(size - offset), 0);
+        if (n > 0) {
+            offset += n;
+            continue;
+        }
+        if (n == 0) break;
+        if (errno == EINTR) continue;
+        if (errno != EXDEV && errno != ENOSYS && errno != EINVAL && errno != EOPNOTSUPP && errno != EPERM) return false;
+        break;
+    }
+    if (size > 0 && offset >= size) return true;
+    return read_write_copy(in, out, offset);
+}
+
+class CopyFileRangeBackend : public CopyBackend {
+public:
+    explicit CopyFileRangeBackend(mode_t umask) : umask_(umask) {}
+
+    void copy(const std::filesystem::path& src, const std::filesystem::path& dest) override {
+        FileDescriptor in(::open(src.c_str(), O_RDONLY | O_CLOEXEC));
+        if (in.get() < 0) throw_errno("cannot open source", src, errno);
+        struct stat st;
+        if (::fstat(in.get(), &st) != 0) throw_errno("cannot stat source", src, errno);
+        if (!S_ISREG(st.st_mode)) {
+            // Let the portable path report the same error std::filesystem would.
+            PortableBackend().copy(src, dest);
+            return;
+        }
+        mode_t mode = st.st_mode & 07777;
+
+        // O_EXCL tells whether the file is new: only then does the open mode apply.
+        bool created = true;
+        int fd = ::open(dest.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, mode);
+        if (fd < 0 && errno == EEXIST) {
+            created = false;
+            fd = ::open(dest.c_str(), O_WRONLY | O_TRUNC | O_CLOEXEC);
+        }
+        FileDescriptor out(fd);
+        if (out.get() < 0) throw_errno("cannot open destination", dest, errno);
+        if (!copy_contents(in.get(), out.get(), st.st_size)) throw_errno("cannot copy", src, errno);
+        if ((!created || (mode & umask_) != 0) && ::fchmod(out.get(), mode) != 0) {
+            throw_errno("cannot set permissions", dest, errno);
+        }
+    }
+
+private:
+    mode_t umask_;
+};
+
+#ifdef SCAFFOLDER_IO_URING
+
+// Minimal io_uring instance driven through the raw syscalls (no liburing dependency). Without
+// SQPOLL the kernel only reads SQEs inside io_uring_enter, so entries are published as handed out.
+class Ring {
+public:
+    ~Ring() {
+        if (sqes_ != MAP_FAILED) ::munmap(sqes_, sqes_size_);
+        if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_) ::munmap(cq_ptr_, cq_size_);
+        if (sq_ptr_ != MAP_FAILED) ::munmap(sq_ptr_, sq_size_);
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    bool init(unsigned entries) {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+        if (fd_ < 0) return false;
+
+        sq_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+        sq_ptr_ = ::mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+        if (sq_ptr_ == MAP_FAILED) return false;
+        cq_ptr_ = single_mmap ? sq_ptr_
+                              : ::mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+        if (cq_ptr_ == MAP_FAILED) return false;
+        sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) return false;
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        auto* sq = static_cast<char*>(sq_ptr_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        sq_entries_ = p.sq_entries;
+        auto* cq = static_cast<char*>(cq_ptr_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        return true;
+    }
+
+    io_uring_sqe* next_sqe(std::uint64_t user_data) {
+        unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        unsigned tail = *sq_tail_;
+        if (tail - head >= sq_entries_) return nullptr;
+        unsigned index = tail & sq_mask_;
+        io_uring_sqe* sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->user_data = user_data;
+        sq_array_[index] = index;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+        ++queued_;
+        return sqe;
+    }
+
+    /** Submits all queued entries and hands each of their completions to on_cqe. */
+    template <typename F>
+    bool run(F&& on_cqe) {
+        unsigned expected = queued_;
+        while (queued_ > 0) {
+            int ret = static_cast<int>(::syscall(__NR_io_uring_enter, fd_, queued_, queued_, IORING_ENTER_GETEVENTS, nullptr, 0));
+            if (ret < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            if (ret == 0) return false;
+            queued_ -= static_cast<unsigned>(ret);
+        }
+        while (expected > 0) {
+            unsigned head = *cq_head_;
+            unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            if (head == tail) {
+                int ret = static_cast<int>(::syscall(__NR_io_uring_enter, fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+                if (ret < 0 && errno != EINTR) return false;
+                continue;
+            }
+            for (; head != tail && expected > 0; ++head, --expected) {
+                on_cqe(cqes_[head & cq_mask_]);
+            }
+            __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        }
+        return true;
+    }
+
+private:
+    int fd_ = -1;
+    void* sq_ptr_ = MAP_FAILED;
+    void* cq_ptr_ = MAP_FAILED;
+    io_uring_sqe* sqes_ = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sq_size_ = 0;
+    size_t cq_size_ = 0;
+    size_t sqes_size_ = 0;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned queued_ = 0;
+};
+
+// Copies small files in three io_uring submissions per batch (open+statx source; open destination
+// + read; write+close), instead of six or more syscalls per file. Large or irregular files, and any
+// file whose ring operation fails, go through copy_file_range so errors are reported as usual.
+class IoUringBackend : public CopyBackend {
+public:
+    explicit IoUringBackend(mode_t umask) : umask_(umask), fallback_(umask) {}
+
+    void copy(const std::filesystem::path& src, const std::filesystem::path& dest) override {
+        fallback_.copy(src, dest);
+    }
+
+    void copy_batch(const std::vector<CopyJob>& jobs) override {
+        for (size_t first = 0; first < jobs.size(); first += kMaxBatch) {
+            size_t count = std::min(kMaxBatch, jobs.size() - first);
+            copy_chunk(&jobs[first], count);
+        }
+    }
+
+private:
+    static constexpr size_t kMaxBatch = 32;
+    static constexpr size_t kSlotSize = 64 * 1024;
+    static constexpr unsigned kRingEntries = 128;  // three SQEs per file in the last round
+
+    enum Op : std::uint64_t { OpenSrc, Statx, OpenDest, Read, Write, CloseDest, CloseSrc };
+
+    struct Slot {
+        int in = -1;
+        int out = -1;
+        struct statx stx;
+        ssize_t nread = 0;
+        bool existed = false;
+        bool fallback = false;
+    };
+
+    static std::uint64_t tag(size_t slot, Op op) { return (static_cast<std::uint64_t>(slot) << 3) | op; }
+
+    struct ThreadState {
+        Ring ring;
+        bool usable = false;
+        std::vector<char> buffers;
+    };
+
+    static ThreadState* thread_state() {
+        thread_local ThreadState state;
+        thread_local bool initialized = false;
+        if (!initialized) {
+            initialized = true;
+            state.usable = state.ring.init(kRingEntries);
+            if (state.usable) state.buffers.resize(kMaxBatch * kSlotSize);
+        }
+        return state.usable ? &state : nullptr;
+    }
+
+    void copy_chunk(const CopyJob* jobs, size_t count) {
+        ThreadState* ts = thread_state();
+        if (!ts) {
+            for (size_t i = 0; i < count; ++i) fallback_.copy(jobs[i].src, jobs[i].dest);
+            return;
+        }
+        Ring& ring = ts->ring;
+        std::vector<Slot> slots(count);
+        auto active = [&slots](size_t i) { return !slots[i].fallback; };
+
+        // Round 1: open and stat every source.
+        for (size_t i = 0; i < count; ++i) {
+            io_uring_sqe* sqe = ring.next_sqe(tag(i, OpenSrc));
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<std::uintptr_t>(jobs[i].src.c_str());
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+            sqe = ring.next_sqe(tag(i, Statx));
+            sqe->opcode = IORING_OP_STATX;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<std::uintptr_t>(jobs[i].src.c_str());
+            sqe->len = STATX_TYPE | STATX_MODE | STATX_SIZE;
+            sqe->off = reinterpret_cast<std::uintptr_t>(&slots[i].stx);
+        }
+        bool ring_ok = ring.run([&slots](const io_uring_cqe& cqe) {
+            Slot& s = slots[cqe.user_data >> 3];
+            if ((cqe.user_data & 7) == OpenSrc && cqe.res >= 0) s.in = cqe.res;
+            if (cqe.res < 0) s.fallback = true;
+        });
+        for (size_t i = 0; ring_ok && i < count; ++i) {
+            const auto& stx = slots[i].stx;
+            if (active(i) && (!S_ISREG(stx.stx_mode) || stx.stx_size >= kSlotSize)) slots[i].fallback = true;
+        }
+
+        // Round 2: create destinations and read sources into their slot buffers.
+        for (size_t i = 0; ring_ok && i < count; ++i) {
+            if (!active(i)) continue;
+            io_uring_sqe* sqe = ring.next_sqe(tag(i, OpenDest));
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<std::uintptr_t>(jobs[i].dest.c_str());
+            sqe->len = slots[i].stx.stx_mode & 07777;
+            sqe->open_flags = O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC;
+            sqe = ring.next_sqe(tag(i, Read));
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = slots[i].in;
+            sqe->addr = reinterpret_cast<std::uintptr_t>(ts->buffers.data() + i * kSlotSize);
+            sqe->len = kSlotSize;
+        }
+        if (ring_ok) {
+            ring_ok = ring.run([&slots](const io_uring_cqe& cqe) {
+                Slot& s = slots[cqe.user_data >> 3];
+                if ((cqe.user_data & 7) == OpenDest) {
+                    if (cqe.res >= 0) s.out = cqe.res;
+                    else if (cqe.res == -EEXIST) s.existed = true;
+                    else s.fallback = true;
+                } else if (cqe.res >= 0 && static_cast<std::uint64_t>(cqe.res) == s.stx.stx_size) {
+                    s.nread = cqe.res;
+                } else {
+                    // Read error, a short read (FUSE, NFS) or a file that changed size since statx.
+                    s.fallback = true;
+                }
+            });
+        }
+
+        // Existing destinations are truncated instead; the open mode does not apply to them.
+        bool reopen = false;
+        for (size_t i = 0; ring_ok && i < count; ++i) {
+            if (!active(i) || !slots[i].existed) continue;
+            io_uring_sqe* sqe = ring.next_sqe(tag(i, OpenDest));
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = reinterpret_cast<std::uintptr_t>(jobs[i].dest.c_str());
+            sqe->open_flags = O_WRONLY | O_TRUNC | O_CLOEXEC;
+            reopen = true;
+        }
+        if (ring_ok && reopen) {
+            ring_ok = ring.run([&slots](const io_uring_cqe& cqe) {
+                Slot& s = slots[cqe.user_data >> 3];
+                if (cqe.res >= 0) s.out = cqe.res;
+                else s.fallback = true;
+            });
+        }
+        for (size_t i = 0; ring_ok && i < count; ++i) {
+            mode_t mode = slots[i].stx.stx_mode & 07777;
+            if (active(i) && (slots[i].existed || (mode & umask_) != 0) && ::fchmod(slots[i].out, mode) != 0) {
+                slots[i].fallback = true;
+            }
+        }
+
+        // Round 3: write each buffer and close both descriptors.
+        for (size_t i = 0; ring_ok && i < count; ++i) {
+            if (!active(i)) continue;
+            io_uring_sqe* sqe = ring.next_sqe(tag(i, Write));
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = slots[i].out;
+            sqe->addr = reinterpret_cast<std::uintptr_t>(ts->buffers.data() + i * kSlotSize);
+            sqe->len = static_cast<unsigned>(slots[i].nread);
+            sqe->flags = IOSQE_IO_LINK;
+            sqe = ring.next_sqe(tag(i, CloseDest));
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = slots[i].out;
+            sqe = ring.next_sqe(tag(i, CloseSrc));
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = slots[i].in;
+        }
+        if (ring_ok) {
+            ring_ok = ring.run([&slots](const io_uring_cqe& cqe) {
+                Slot& s = slots[cqe.user_data >> 3];
+                switch (cqe.user_data & 7) {
+                case Write:
+                    if (cqe.res != s.nread) s.fallback = true;
+                    break;
+                case CloseDest:
+                    // A failed write cancels the linked close.
+                    if (cqe.res == -ECANCELED) ::close(s.out);
+                    else if (cqe.res < 0) s.fallback = true;
+                    s.out = -1;
+                    break;
+                case CloseSrc:
+                    s.in = -1;
+                    break;
+                default:
+                    break;
+                }
+            });
+        }
+
+        if (!ring_ok) {
+            // The ring may still own descriptors of unreaped operations; leave them rather than
+            // risk closing a reused descriptor, and stop using this ring.
+            ts->usable = false;
+            for (size_t i = 0; i < count; ++i) fallback_.copy(jobs[i].src, jobs[i].dest);
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            Slot& s = slots[i];
+            if (s.in >= 0) ::close(s.in);
+            if (s.out >= 0) ::close(s.out);
+            if (s.fallback) fallback_.copy(jobs[i].src, jobs[i].dest);
+        }
+    }
+
+    mode_t umask_;
+    CopyFileRangeBackend fallback_;
+};
+
+#endif  // SCAFFOLDER_IO_URING
+
+#endif  // __linux__
+
+}  // namespace
+
+std::unique_ptr<CopyBackend> make_copy_backend(CopyBackendKind kind) {
+#if defined(__linux__)
+    // Called before any copy thread starts, so briefly clearing the umask cannot race.
+    mode_t mask = ::umask(0);
+    ::umask(mask);
+    if (kind == CopyBackendKind::IoUring) {
+#ifdef SCAFFOLDER_IO_URING
+        return std::make_unique<IoUringBackend>(mask);
+#else
+        kind = CopyBackendKind::CopyFileRange;
+#endif
+    }
+    if (kind == CopyBackendKind::CopyFileRange) return std::make_unique<CopyFileRangeBackend>(mask);
+#else
+    (void)kind;
+#endif
+    return std::make_unique<PortableBackend>();
+}
+
+}  // namespace scaffolder
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace scaffolder {
+
+struct CopyJob {
+    std::filesystem::path src;
+    std::filesystem::path dest;
+};
+
+enum class CopyBackendKind {
+    Portable,       // std::filesystem::copy_file
+    CopyFileRange,  // in-kernel copy_file_range (Linux), read/write where the kernel refuses
+    IoUring         // batched open/read/write/close through io_uring (Linux), else CopyFileRange
+};
+
+/** Byte copy of a regular file: dest is created or truncated and gets the source permissions.
+ *  Backends are shared by all copy workers and must be thread-safe. */
+class CopyBackend {
+public:
+    virtual ~CopyBackend() = default;
+    virtual void copy(const std::filesystem::path& src, const std::filesystem::path& dest) = 0;
+
+    /** Copies many files at once; backends that can amortize syscalls override this. */
+    virtual void copy_batch(const std::vector<CopyJob>& jobs) {
+        for (const auto& job : jobs) copy(job.src, job.dest);
+    }
+};
+
+/** Creates the requested backend, degrading to the next portable one where it is unavailable. */
+std::unique_ptr<CopyBackend> make_copy_backend(CopyBackendKind kind);
+
+}  // namespace scaffolder
@@ -1,74 +1,412 @@
 #include "copy/copy_engine.hpp"
+#include "util/thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
 #include <fstream>
-#include <iostream>
+#include <functional>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace scaffolder {
 
-CopyEngine::CopyEngine(PathResolver& resolver, const std::filesystem::path& output_root)
-    : resolver_(resolver), output_root_(output_root) {}
+namespace {
 
-void CopyEngine::copy_file(const std::filesystem::path& src, const std::filesystem::path& dest) {
-    std::filesystem::create_directories(dest.parent_path());
-    std::filesystem::copy_file(src, dest, std::filesystem::copy_options::overwrite_existing);
+bool same_content(const std::filesystem::path& a, const std::filesystem::path& b) {
+    std::ifstream fa(a, std::ios::binary);
+    std::ifstream fb(b, std::ios::binary);
+    if (!fa || !fb) return false;
+    char buf_a[65536];
+    char buf_b[65536];
+    for (;;) {
+        fa.read(buf_a, sizeof(buf_a));
+        fb.read(buf_b, sizeof(buf_b));
+        std::streamsize n = fa.gcount();
+        if (n != fb.gcount()) return false;
+        if (n == 0) return true;
+        if (!std::equal(buf_a, buf_a + n, buf_b)) return false;
+    }
 }
 
-void CopyEngine::copy_tree(const SwComponent& comp, const std::filesystem::path& src, const std::filesystem::path& dest) {
-    PathFilters pf = comp.filters.value_or(PathFilters{});
-    Filter filter(pf);
+// Decides which non-directory entries of a component's source tree are copied and which
+// directories are worth entering. Variants copy every regular file that passes the path filters;
+// other components also require a known extension.
+class FileSelector {
+public:
+    explicit FileSelector(const SwComponent& comp)
+        : filter_(comp.filters.value_or(PathFilters{})),
+          any_file_(comp.type == "variant") {
+        extensions_.add(comp.source_extensions.value_or(std::vector<std::string>{"*.c", "*.cpp", "*.cc"}));
+        extensions_.add(comp.include_extensions.value_or(std::vector<std::string>{"*.h", "*.hpp"}));
+        extensions_.add(comp.metadata_extensions.value_or(std::vector<std::string>{}));
+    }
 
-    auto src_ext = comp.source_extensions.value_or(std::vector<std::string>{"*.c", "*.cpp", "*.cc"});
-    auto inc_ext = comp.include_extensions.value_or(std::vector<std::string>{"*.h", "*.hpp"});
-    auto meta_ext = comp.metadata_extensions.value_or(std::vector<std::string>{});
+    /** entry is a non-directory entry at rel, relative to the component source. */
+    bool selects(const DirEntry& entry, const std::string& rel) const {
+        if (any_file_) {
+            return entry.kind == EntryKind::File && filter_.includes_relative(rel);
+        }
+        // Source, include and metadata extensions are alternatives, so one set answers all three.
+        return extensions_.matches_name(entry.name) && filter_.includes_relative(rel);
+    }
 
-    for (auto it = std::filesystem::recursive_directory_iterator(src, std::filesystem::directory_options::skip_permission_denied);
-         it != std::filesystem::recursive_directory_iterator(); ++it) {
-        const auto& entry = *it;
-        if (!filter.should_include(entry.path(), src)) continue;
+    bool descends(const std::string& rel) const { return !filter_.prunes_relative(rel); }
 
-        if (entry.is_directory()) continue;
+    /** Sparse-checkout patterns covering at least every file selects() accepts; empty for all files.
+     *  Include paths match as substrings across '/', which no pattern expresses, so only the
+     *  extensions and the plain exclude paths narrow the checkout. */
+    std::vector<std::string> sparse_patterns() const {
+        std::vector<std::string> patterns;
+        if (any_file_) {
+            patterns.push_back("*");
+        } else {
+            for (const auto& ext : extensions_.extensions()) {
+                if (ext.find_first_of("/\\*?[]!#") != std::string::npos) return {};
+                patterns.push_back("*" + ext);
+            }
+            std::sort(patterns.begin(), patterns.end());
+        }
+        std::vector<std::string> exclusions = filter_.sparse_exclusions();
+        if (patterns.empty() || (any_file_ && exclusions.empty())) return {};
+        patterns.insert(patterns.end(), exclusions.begin(), exclusions.end());
+        return patterns;
+    }
 
-        bool is_source = filter.matches_extension(entry.path(), src_ext);
-        bool is_include = filter.matches_extension(entry.path(), inc_ext);
-        bool is_metadata = !meta_ext.empty() && filter.matches_extension(entry.path(), meta_ext);
-        if (!is_source && !is_include && !is_metadata) continue;
+private:
+    Filter filter_;
+    bool any_file_;
+    ExtensionSet extensions_;
+};
 
-        std::filesystem::path rel = std::filesystem::relative(entry.path(), src);
-        std::filesystem::path dest_path = dest / rel;
-        copy_file(entry.path(), dest_path);
+// Clones src into dest with FICLONE. Returns false when the filesystem cannot share extents
+// (other filesystem, different device, no reflink support) so the caller can copy instead.
+bool reflink_file(const std::filesystem::path& src, const std::filesystem::path& dest) {
+#if defined(__linux__) && defined(FICLONE)
+    int in = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) return false;
+    struct stat st;
+    if (::fstat(in, &st) != 0) {
+        ::close(in);
+        return false;
+    }
+    int out = ::open(dest.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, st.st_mode & 07777);
+    if (out < 0) {
+        ::close(in);
+        return false;
     }
+    bool ok = ::ioctl(out, FICLONE, in) == 0 && ::fchmod(out, st.st_mode & 07777) == 0;
+    ::close(out);
+    ::close(in);
+    return ok;
+#else
+    (void)src;
+    (void)dest;
+    return false;
+#endif
 }
 
-void CopyEngine::copy_component(const SwComponent& comp) {
-    if (comp.type == "external" || comp.type == "layer") return;
-    if ((!comp.source && !comp.git) || !comp.dest) return;
+}  // namespace
 
-    if (comp.type == "variant") {
-        std::filesystem::path src = resolver_.resolve_source(comp);
-        std::filesystem::path dest_path = resolver_.resolve_dest(comp, output_root_);
-        if (std::filesystem::exists(src)) {
-            PathFilters pf = comp.filters.value_or(PathFilters{});
-            Filter filter(pf);
-            for (auto it = std::filesystem::recursive_directory_iterator(src, std::filesystem::directory_options::skip_permission_denied);
-                 it != std::filesystem::recursive_directory_iterator(); ++it) {
-                if (!it->is_regular_file()) continue;
-                if (!filter.should_include(it->path(), src)) continue;
-                std::filesystem::path rel = std::filesystem::relative(it->path(), src);
-                copy_file(it->path(), dest_path / rel);
-            }
+// Plan being built; parallel walks add each directory's files under the mutex.
+struct CopyEngine::PlanBuild {
+    CopyPlan plan;
+    std::mutex mutex;
+};
+
+// One component tree being planned, by one recursive call or by pool tasks, one per directory.
+struct CopyEngine::TreeWalk {
+    TreeWalk(const SwComponent& comp, PlanBuild& b, uint32_t r)
+        : selector(comp), build(b), root(r), src(b.plan.roots()[r].src), dest(b.plan.roots()[r].dest),
+          staged(b.plan.roots()[r].staged) {}
+
+    FileSelector selector;
+    PlanBuild& build;
+    uint32_t root;
+    std::filesystem::path src;
+    std::filesystem::path dest;
+    bool staged;
+};
+
+CopyEngine::CopyEngine(PathResolver& resolver, const std::filesystem::path& output_root, CopyOptions options)
+    : resolver_(resolver), output_root_(output_root), options_(options), backend_(make_copy_backend(options.backend)) {}
+
+bool CopyEngine::is_up_to_date(const std::filesystem::path& src, const std::filesystem::path& dest) const {
+    std::error_code ec;
+    auto st = std::filesystem::symlink_status(dest, ec);
+    if (ec) return false;
+    if (options_.materialize == Materialize::Symlink) {
+        return std::filesystem::is_symlink(st) && std::filesystem::read_symlink(dest, ec) == std::filesystem::absolute(src);
+    }
+    if (!std::filesystem::is_regular_file(st)) return false;
+    if (options_.materialize == Materialize::Hardlink) {
+        if (std::filesystem::equivalent(src, dest, ec)) return true;
+    } else if (std::filesystem::hard_link_count(dest, ec) > 1) {
+        // Left by a hardlink run: a copy mode must replace it with an independent file.
+        return false;
+    }
+    auto dest_size = std::filesystem::file_size(dest, ec);
+    if (ec || dest_size != std::filesystem::file_size(src)) return false;
+    if (options_.compare == CompareMode::Content) return same_content(src, dest);
+    auto dest_time = std::filesystem::last_write_time(dest, ec);
+    return !ec && dest_time == std::filesystem::last_write_time(src);
+}
+
+void CopyEngine::release_destination(const std::filesystem::path& dest) const {
+    std::error_code ec;
+    auto st = std::filesystem::symlink_status(dest, ec);
+    if (ec || !std::filesystem::exists(st)) return;
+    // Writing through a symlink or a hard link from an earlier link-mode run would modify the
+    // source file, and link modes need the path to be free.
+    bool linking = options_.materialize == Materialize::Hardlink || options_.materialize == Materialize::Symlink;
+    if (linking || std::filesystem::is_symlink(st) ||
+        (std::filesystem::is_regular_file(st) && std::filesystem::hard_link_count(dest, ec) > 1)) {
+        std::filesystem::remove(dest);
+    }
+}
+
+bool CopyEngine::link_file(const std::filesystem::path& src, const std::filesystem::path& dest) const {
+    std::error_code ec;
+    switch (options_.materialize) {
+    case Materialize::Hardlink:
+        std::filesystem::create_hard_link(src, dest, ec);
+        return !ec;
+    case Materialize::Symlink:
+        std::filesystem::create_symlink(std::filesystem::absolute(src), dest, ec);
+        return !ec;
+    case Materialize::Reflink:
+        return reflink_file(src, dest);
+    case Materialize::Copy:
+        break;
+    }
+    return false;
+}
+
+PlanReason CopyEngine::classify(const std::filesystem::path& src, const std::filesystem::path& dest, bool staged) const {
+    std::error_code ec;
+    auto st = std::filesystem::symlink_status(dest, ec);
+    if (!std::filesystem::exists(st)) return PlanReason::New;
+    if (!options_.incremental) return PlanReason::Overwrite;
+    if (staged) {
+        // A staged file is new every run, so only its content can tell whether dest is current.
+        bool current = std::filesystem::is_regular_file(st) && std::filesystem::hard_link_count(dest, ec) == 1 &&
+                       std::filesystem::file_size(dest, ec) == std::filesystem::file_size(src) && same_content(src, dest);
+        return current ? PlanReason::Unchanged : PlanReason::Changed;
+    }
+    return is_up_to_date(src, dest) ? PlanReason::Unchanged : PlanReason::Changed;
+}
+
+bool CopyEngine::prepare_file(const std::filesystem::path& src, const std::filesystem::path& dest) {
+    ensure_directory(dest.parent_path());
+    release_destination(dest);
+
+    if (!link_file(src, dest)) return true;
+    if (options_.incremental && options_.materialize == Materialize::Reflink) {
+        std::filesystem::last_write_time(dest, std::filesystem::last_write_time(src));
+    }
+    ++linked_;
+    return false;
+}
+
+bool CopyEngine::move_file(const std::filesystem::path& src, const std::filesystem::path& dest) {
+    ensure_directory(dest.parent_path());
+    // rename() replaces the directory entry, so a symlink or hard link left at dest is not written through.
+    std::error_code ec;
+    std::filesystem::rename(src, dest, ec);
+    if (ec) {
+        release_destination(dest);
+        return false;
+    }
+    ++moved_;
+    return true;
+}
+
+void CopyEngine::ensure_directory(const std::filesystem::path& dir) {
+    {
+        std::lock_guard<std::mutex> lock(dirs_mutex_);
+        if (created_dirs_.count(dir.native()) != 0) return;
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    // A parallel copy may create the same parent concurrently; only fail if it is still missing.
+    if (ec && !std::filesystem::is_directory(dir)) {
+        throw std::filesystem::filesystem_error("cannot create directory", dir, ec);
+    }
+    std::lock_guard<std::mutex> lock(dirs_mutex_);
+    created_dirs_.insert(dir.native());
+}
+
+void CopyEngine::flush(std::vector<CopyJob>& batch) {
+    if (batch.empty()) return;
+    backend_->copy_batch(batch);
+    for (const auto& job : batch) {
+        // Keeping the source mtime lets the next incremental run recognise the file as current.
+        if (options_.incremental) {
+            std::filesystem::last_write_time(job.dest, std::filesystem::last_write_time(job.src));
         }
-        return;
+        ++copied_;
     }
+    batch.clear();
+}
+
+bool CopyEngine::is_copied(const SwComponent& comp) const {
+    if (comp.type == "external" || comp.type == "layer") return false;
+    return (comp.source || comp.git) && comp.dest;
+}
+
+void CopyEngine::plan_directory(const TreeWalk& walk, const DirectoryReader& dir, const std::string& rel,
+                                std::vector<std::string>& subdirs) {
+    struct Planned {
+        std::string rel;
+        uint64_t size;
+        int64_t mtime;
+        PlanReason reason;
+    };
+    std::vector<Planned> files;
+    for (const auto& entry : dir.entries()) {
+        std::string entry_rel = join_relative(rel, entry.name);
+        if (entry.kind == EntryKind::Directory) {
+            // Symlinked directories are not followed.
+            if (!entry.symlink && walk.selector.descends(entry_rel)) subdirs.push_back(entry.name);
+            continue;
+        }
+        if (!walk.selector.selects(entry, entry_rel)) continue;
+        std::filesystem::path src = dir.path() / entry.name;
+        std::error_code ec;
+        uint64_t size = std::filesystem::file_size(src, ec);
+        if (ec) size = 0;
+        auto mtime = std::filesystem::last_write_time(src, ec);
+        PlanReason reason = classify(src, walk.dest / entry_rel, walk.staged);
+        files.push_back({std::move(entry_rel), size, ec ? 0 : static_cast<int64_t>(mtime.time_since_epoch().count()), reason});
+    }
+
+    std::lock_guard<std::mutex> lock(walk.build.mutex);
+    for (const auto& f : files) walk.build.plan.add(walk.root, f.rel, f.size, f.mtime, f.reason);
+}
+
+void CopyEngine::plan_tree(const TreeWalk& walk, const DirectoryReader& dir, const std::string& rel) {
+    // Depth-first, holding one descriptor per level so each subdirectory opens relative to its parent.
+    std::vector<std::string> subdirs;
+    plan_directory(walk, dir, rel, subdirs);
+    for (const auto& name : subdirs) plan_tree(walk, DirectoryReader(dir, name), join_relative(rel, name));
+}
 
-    std::filesystem::path src = resolver_.resolve_source(comp);
-    std::filesystem::path dest_path = resolver_.resolve_dest(comp, output_root_);
+void CopyEngine::walk_directory(ThreadPool& pool, const std::shared_ptr<TreeWalk>& walk, const std::string& rel) {
+    // Tasks run on any worker after the parent listing is done, so they open by path instead of
+    // holding the parent descriptor open for every queued subdirectory.
+    DirectoryReader dir(rel.empty() ? walk->src : walk->src / rel);
+    std::vector<std::string> subdirs;
+    plan_directory(*walk, dir, rel, subdirs);
+    for (const auto& name : subdirs) {
+        pool.submit([this, &pool, walk, sub_rel = join_relative(rel, name)] { walk_directory(pool, walk, sub_rel); });
+    }
+}
 
-    if (!std::filesystem::exists(src)) return;
+CopyPlan CopyEngine::plan(const std::vector<SwComponent>& components) {
+    PlanBuild build;
+    std::vector<std::shared_ptr<TreeWalk>> walks;
+    for (const auto& comp : components) {
+        if (!is_copied(comp)) continue;
+        std::filesystem::path src = resolver_.resolve_source(comp);
+        if (!std::filesystem::exists(src)) continue;
+        uint32_t root = build.plan.add_root(comp.id, src, resolver_.resolve_dest(comp, output_root_),
+                                            options_.staged.count(comp.id) != 0);
+        walks.push_back(std::make_shared<TreeWalk>(comp, build, root));
+    }
 
-    if (comp.structure == "hierarchical") {
-        copy_tree(comp, src, dest_path);
+    unsigned jobs = ThreadPool::resolve_jobs(options_.jobs);
+    if (jobs <= 1) {
+        for (const auto& walk : walks) plan_tree(*walk, DirectoryReader(walk->src), {});
     } else {
-        copy_tree(comp, src, dest_path);
+        // Every directory of every component is its own task, so idle workers steal subtrees of a
+        // large component instead of waiting on it.
+        ThreadPool pool(jobs);
+        for (const auto& walk : walks) {
+            pool.submit([this, &pool, walk] { walk_directory(pool, walk, {}); });
+        }
+        pool.wait();
+    }
+    // Overlapping destinations resolve to the last component in metadata order, as in a serial copy.
+    build.plan.finalize();
+    return std::move(build.plan);
+}
+
+// Completion tracking for execute(): entries left per root, and who to tell when one reaches zero.
+struct CopyEngine::RootProgress {
+    explicit RootProgress(size_t roots) : remaining(roots) {}
+
+    void finished(uint32_t root) {
+        if (--remaining[root] == 0 && on_done) on_done(root);
+    }
+
+    std::vector<std::atomic<size_t>> remaining;
+    std::function<void(uint32_t)> on_done;
+};
+
+void CopyEngine::execute_range(const CopyPlan& plan, size_t begin, size_t end, RootProgress& progress) {
+    std::vector<CopyJob> batch;
+    for (size_t i = begin; i < end; ++i) {
+        const CopyPlan::Entry& entry = plan.entries()[i];
+        if (entry.reason == PlanReason::Unchanged) {
+            ++unchanged_;
+            continue;
+        }
+        std::filesystem::path src = plan.source(entry);
+        std::filesystem::path dest = plan.destination(entry);
+        if (plan.roots()[entry.root].staged) {
+            if (!move_file(src, dest)) batch.push_back({std::move(src), std::move(dest)});
+        } else if (prepare_file(src, dest)) {
+            batch.push_back({std::move(src), std::move(dest)});
+        }
+    }
+    flush(batch);
+    for (size_t i = begin; i < end; ++i) progress.finished(plan.entries()[i].root);
+}
+
+void CopyEngine::execute(const CopyPlan& plan, const std::function<void(uint32_t root)>& on_root_done) {
+    const auto& entries = plan.entries();
+    RootProgress progress(plan.roots().size());
+    for (const auto& e : entries) ++progress.remaining[e.root];
+    if (on_root_done) {
+        for (uint32_t r = 0; r < plan.roots().size(); ++r) {
+            if (progress.remaining[r] == 0) on_root_done(r);
+        }
+    }
+    progress.on_done = on_root_done;
+
+    size_t count = entries.size();
+    unsigned jobs = ThreadPool::resolve_jobs(options_.jobs);
+    if (jobs <= 1) {
+        for (size_t begin = 0; begin < count; begin += kBatchSize) {
+            execute_range(plan, begin, std::min(begin + kBatchSize, count), progress);
+        }
+        return;
+    }
+    // The plan holds each destination once and is sorted by directory, so batches are independent
+    // and mostly touch a single destination directory.
+    ThreadPool pool(jobs);
+    for (size_t begin = 0; begin < count; begin += kBatchSize) {
+        pool.submit([this, &plan, &progress, begin, end = std::min(begin + kBatchSize, count)] {
+            execute_range(plan, begin, end, progress);
+        });
     }
+    pool.wait();
+}
+
+void CopyEngine::copy_component(const SwComponent& comp) {
+    execute(plan({comp}));
+}
+
+void CopyEngine::copy_components(const std::vector<SwComponent>& components) {
+    execute(plan(components));
+}
+
+std::vector<std::string> sparse_checkout_patterns(const SwComponent& comp) {
+    return FileSelector(comp).sparse_patterns();
 }
 
 }  // namespace scaffolder
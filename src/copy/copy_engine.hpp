@@ -1,22 +1,116 @@
 #pragma once
 
 #include "../metadata/schema.hpp"
+#include "copy_backend.hpp"
+#include "copy_plan.hpp"
+#include "directory_reader.hpp"
 #include "filter.hpp"
 #include "../resolver/path_resolver.hpp"
+#include <atomic>
+#include <cstddef>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
 
 namespace scaffolder {
 
+class ThreadPool;
+
+enum class CompareMode {
+    SizeMtime,  // destination is current when size and mtime equal the source
+    Content     // destination is current when size and bytes equal the source
+};
+
+/** How a selected source file appears in the output tree. Link modes fall back to a byte copy
+ *  per file when the filesystem refuses (cross-device, no reflink support, no symlink privilege). */
+enum class Materialize {
+    Copy,
+    Hardlink,  // shares the source inode: editing the output edits the source
+    Reflink,   // copy-on-write clone (FICLONE on Linux btrfs/xfs)
+    Symlink    // absolute symlink to the source file
+};
+
+struct CopyOptions {
+    unsigned jobs = 1;          // > 1: parallel copy, 0: one worker per hardware thread
+    bool incremental = false;   // skip up-to-date files; copies keep the source mtime
+    CompareMode compare = CompareMode::SizeMtime;
+    Materialize materialize = Materialize::Copy;
+    CopyBackendKind backend = CopyBackendKind::Portable;
+    /** Components whose source is a staging tree written for this run (GitCache::stage): their
+     *  files are renamed into the output instead of copied, and materialize does not apply. */
+    std::unordered_set<std::string> staged;
+};
+
+struct CopyStats {
+    size_t copied = 0;
+    size_t linked = 0;     // hardlinked, reflinked or symlinked instead of copied
+    size_t unchanged = 0;
+    size_t moved = 0;      // renamed out of a staged source
+};
+
 class CopyEngine {
 public:
-    CopyEngine(PathResolver& resolver, const std::filesystem::path& output_root);
+    CopyEngine(PathResolver& resolver, const std::filesystem::path& output_root, CopyOptions options = {});
     void copy_component(const SwComponent& comp);
 
+    /** plan() then execute(). */
+    void copy_components(const std::vector<SwComponent>& components);
+
+    /** Walks the component sources and decides, without writing anything, what a copy would do.
+     *  With options.jobs > 1 directories are walked by a work-stealing pool. */
+    CopyPlan plan(const std::vector<SwComponent>& components);
+
+    /** Copies or links every entry of the plan that is not Unchanged, in batches per destination
+     *  directory, on options.jobs workers. on_root_done is called (from any worker) once all
+     *  entries of a plan root are on disk. */
+    void execute(const CopyPlan& plan, const std::function<void(uint32_t root)>& on_root_done = {});
+
+    CopyStats stats() const { return {copied_.load(), linked_.load(), unchanged_.load(), moved_.load()}; }
+
 private:
-    void copy_file(const std::filesystem::path& src, const std::filesystem::path& dest);
-    void copy_tree(const SwComponent& comp, const std::filesystem::path& src, const std::filesystem::path& dest);
+    struct PlanBuild;
+    struct TreeWalk;
+    struct RootProgress;
+
+    // Files needing a byte copy are queued and handed to the backend in batches of this size.
+    static constexpr size_t kBatchSize = 64;
+
+    PlanReason classify(const std::filesystem::path& src, const std::filesystem::path& dest, bool staged) const;
+    /** Prepares the destination and applies link modes. Returns true if src still needs a byte copy. */
+    bool prepare_file(const std::filesystem::path& src, const std::filesystem::path& dest);
+    /** Renames a staged file over dest. Returns false when it must be copied instead (other device). */
+    bool move_file(const std::filesystem::path& src, const std::filesystem::path& dest);
+    void flush(std::vector<CopyJob>& batch);
+    /** create_directories, once per directory for the engine's lifetime. */
+    void ensure_directory(const std::filesystem::path& dir);
+    bool is_up_to_date(const std::filesystem::path& src, const std::filesystem::path& dest) const;
+    void release_destination(const std::filesystem::path& dest) const;
+    bool link_file(const std::filesystem::path& src, const std::filesystem::path& dest) const;
+    bool is_copied(const SwComponent& comp) const;
+    /** Adds the selected files of one directory to the plan and lists the subdirectories to enter. */
+    void plan_directory(const TreeWalk& walk, const DirectoryReader& dir, const std::string& rel,
+                        std::vector<std::string>& subdirs);
+    void plan_tree(const TreeWalk& walk, const DirectoryReader& dir, const std::string& rel);
+    void walk_directory(ThreadPool& pool, const std::shared_ptr<TreeWalk>& walk, const std::string& rel);
+    void execute_range(const CopyPlan& plan, size_t begin, size_t end, RootProgress& progress);
     PathResolver& resolver_;
     std::filesystem::path output_root_;
+    CopyOptions options_;
+    std::unique_ptr<CopyBackend> backend_;
+    std::atomic<size_t> copied_{0};
+    std::atomic<size_t> linked_{0};
+    std::atomic<size_t> unchanged_{0};
+    std::atomic<size_t> moved_{0};
+    std::mutex dirs_mutex_;
+    std::unordered_set<std::string> created_dirs_;
 };
 
+/** Sparse-checkout patterns (gitignore syntax, non-cone) that check out at least every file the
+ *  copy of comp would select, for fetching git sources partially. Empty when no narrowing is safe. */
+std::vector<std::string> sparse_checkout_patterns(const SwComponent& comp);
+
 }  // namespace scaffolder
@@ -0,0 +1,126 @@
+#include "copy/copy_plan.hpp"
+#include "util/hash.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
+
+namespace scaffolder {
+
+StringArena::Ref StringArena::add(std::string_view s) {
+    if (data_.size() + s.size() > UINT32_MAX) throw std::length_error("copy plan string arena is full");
+    Ref ref{static_cast<uint32_t>(data_.size()), static_cast<uint32_t>(s.size())};
+    data_.append(s.data(), s.size());
+    return ref;
+}
+
+const char* to_string(PlanReason reason) {
+    switch (reason) {
+    case PlanReason::New: return "new";
+    case PlanReason::Changed: return "changed";
+    case PlanReason::Overwrite: return "overwrite";
+    case PlanReason::Unchanged: return "unchanged";
+    }
+    return "";
+}
+
+uint32_t CopyPlan::add_root(const std::string& component, const std::filesystem::path& src,
+                            const std::filesystem::path& dest, bool staged) {
+    roots_.push_back({component, src, dest, staged});
+    return static_cast<uint32_t>(roots_.size() - 1);
+}
+
+void CopyPlan::add(uint32_t root, std::string_view rel, uint64_t size, int64_t mtime, PlanReason reason) {
+    entries_.push_back({root, arena_.add(rel), size, mtime, reason});
+}
+
+std::filesystem::path CopyPlan::source(const Entry& e) const {
+    return roots_[e.root].src / std::string(relative(e));
+}
+
+std::filesystem::path CopyPlan::destination(const Entry& e) const {
+    return roots_[e.root].dest / std::string(relative(e));
+}
+
+void CopyPlan::finalize() {
+    struct Key {
+        std::string dir;
+        std::string name;
+        uint32_t root;
+        size_t index;
+    };
+    std::vector<Key> keys;
+    keys.reserve(entries_.size());
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        std::string dest = destination(entries_[i]).lexically_normal().generic_string();
+        size_t slash = dest.rfind('/');
+        std::string dir = slash == std::string::npos ? std::string() : dest.substr(0, slash);
+        std::string name = slash == std::string::npos ? dest : dest.substr(slash + 1);
+        keys.push_back({std::move(dir), std::move(name), entries_[i].root, i});
+    }
+    std::sort(keys.begin(), keys.end(), [](const Key& a, const Key& b) {
+        return std::tie(a.dir, a.name, a.root) < std::tie(b.dir, b.name, b.root);
+    });
+
+    std::vector<Entry> sorted;
+    sorted.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        bool overwritten = i + 1 < keys.size() && keys[i + 1].dir == keys[i].dir && keys[i + 1].name == keys[i].name;
+        if (!overwritten) sorted.push_back(entries_[keys[i].index]);
+    }
+    entries_ = std::move(sorted);
+}
+
+CopyPlan::Summary CopyPlan::summary() const {
+    Summary s;
+    for (const auto& e : entries_) {
+        if (e.reason == PlanReason::Unchanged) {
+            ++s.unchanged;
+        } else {
+            ++s.files;
+            s.bytes += e.size;
+        }
+    }
+    return s;
+}
+
+std::string CopyPlan::fingerprint(uint32_t root) const {
+    Fnv1a hash;
+    hash.field(roots_[root].src.generic_string()).field(roots_[root].dest.generic_string());
+    for (const auto& e : entries_) {
+        if (e.root != root) continue;
+        hash.field(relative(e)).field(e.size).field(roots_[root].staged ? 0 : static_cast<uint64_t>(e.mtime));
+    }
+    return hash.hex();
+}
+
+bool CopyPlan::outputs_present(uint32_t root) const {
+    for (const auto& e : entries_) {
+        if (e.root != root) continue;
+        std::error_code ec;
+        if (std::filesystem::file_size(destination(e), ec) != e.size || ec) return false;
+    }
+    return true;
+}
+
+void CopyPlan::drop_root(uint32_t root) {
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(), [root](const Entry& e) { return e.root == root; }),
+                   entries_.end());
+}
+
+void CopyPlan::write_json(std::ostream& out) const {
+    Summary s = summary();
+    nlohmann::json files = nlohmann::json::array();
+    for (const auto& e : entries_) {
+        files.push_back({{"source", source(e).generic_string()},
+                         {"destination", destination(e).generic_string()},
+                         {"size", e.size},
+                         {"reason", to_string(e.reason)}});
+    }
+    nlohmann::json j;
+    j["summary"] = {{"files", s.files}, {"bytes", s.bytes}, {"unchanged", s.unchanged}};
+    j["files"] = std::move(files);
+    out << j.dump(2) << "\n";
+}
+
+}  // namespace scaffolder
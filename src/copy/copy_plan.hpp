@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace scaffolder {
+
+/** Append-only string storage; plan entries refer to their paths by offset instead of owning them. */
+class StringArena {
+public:
+    struct Ref {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    Ref add(std::string_view s);
+    std::string_view view(Ref ref) const { return std::string_view(data_).substr(ref.offset, ref.size); }
+    size_t bytes() const { return data_.size(); }
+
+private:
+    std::string data_;
+};
+
+/** Why a file is in the plan. */
+enum class PlanReason {
+    New,        // nothing at the destination yet
+    Changed,    // incremental: destination differs from the source
+    Overwrite,  // not incremental: destination exists and is replaced unconditionally
+    Unchanged   // incremental: destination is current, the executor skips it
+};
+
+const char* to_string(PlanReason reason);
+
+/** Every file a copy run would touch, in destination order. Paths are stored as a component root
+ *  (one per copied component) plus a '/'-separated path relative to it. */
+class CopyPlan {
+public:
+    struct Root {
+        std::string component;
+        std::filesystem::path src;
+        std::filesystem::path dest;
+        bool staged = false;  // src is a throwaway tree of this run: files are moved, not copied
+    };
+
+    struct Entry {
+        uint32_t root;
+        StringArena::Ref rel;
+        uint64_t size;
+        int64_t mtime;  // source last_write_time, in file clock ticks
+        PlanReason reason;
+    };
+
+    struct Summary {
+        size_t files = 0;     // files the executor writes (everything except Unchanged)
+        uint64_t bytes = 0;   // source bytes of those files
+        size_t unchanged = 0;
+    };
+
+    /** Roots must be added in metadata order: when two components map a file to the same
+     *  destination, the entry of the later root wins, as the later copy did before planning. */
+    uint32_t add_root(const std::string& component, const std::filesystem::path& src, const std::filesystem::path& dest,
+                      bool staged = false);
+    void add(uint32_t root, std::string_view rel, uint64_t size, int64_t mtime, PlanReason reason);
+
+    /** Drops entries overwritten by a later root and sorts by destination directory, then name. */
+    void finalize();
+
+    const std::vector<Entry>& entries() const { return entries_; }
+    const std::vector<Root>& roots() const { return roots_; }
+    std::string_view relative(const Entry& e) const { return arena_.view(e.rel); }
+    std::filesystem::path source(const Entry& e) const;
+    std::filesystem::path destination(const Entry& e) const;
+    Summary summary() const;
+
+    /** Hash of a root's source and destination and of the path, size and mtime of its entries;
+     *  changes whenever the files that root would copy change. Staged sources are rewritten each
+     *  run, so their mtimes are left out; their directory name identifies the content instead.
+     *  Call after finalize(). */
+    std::string fingerprint(uint32_t root) const;
+    /** True when every destination of the root exists with its planned size. */
+    bool outputs_present(uint32_t root) const;
+    /** Removes the entries of a root whose output is known to be complete. */
+    void drop_root(uint32_t root);
+
+    /** {"summary": {...}, "files": [{"source", "destination", "size", "reason"}, ...]} */
+    void write_json(std::ostream& out) const;
+
+private:
+    std::vector<Root> roots_;
+    std::vector<Entry> entries_;
+    StringArena arena_;
+};
+
+}  // namespace scaffolder
@@ -0,0 +1,124 @@
+#include "copy/directory_reader.hpp"
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <system_error>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace scaffolder {
+
+#if defined(__linux__)
+
+namespace {
+
+// Record layout returned by the getdents64 syscall.
+struct LinuxDirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+EntryKind kind_of(mode_t mode) {
+    if (S_ISDIR(mode)) return EntryKind::Directory;
+    if (S_ISREG(mode)) return EntryKind::File;
+    return EntryKind::Other;
+}
+
+}  // namespace
+
+DirectoryReader::DirectoryReader(const std::filesystem::path& path) : path_(path) {
+    // A symlinked root is followed, like std::filesystem iterators do.
+    open_at(AT_FDCWD, path_.c_str(), 0);
+}
+
+DirectoryReader::DirectoryReader(const DirectoryReader& parent, const std::string& name) : path_(parent.path_ / name) {
+    if (parent.fd_ >= 0) open_at(parent.fd_, name.c_str(), O_NOFOLLOW);
+}
+
+DirectoryReader::~DirectoryReader() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+void DirectoryReader::open_at(int dir_fd, const char* name, int flags) {
+    fd_ = ::openat(dir_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC | flags);
+    if (fd_ < 0 && errno != EACCES && errno != EPERM) {
+        throw std::filesystem::filesystem_error("cannot open directory", path_, std::error_code(errno, std::generic_category()));
+    }
+}
+
+std::vector<DirEntry> DirectoryReader::entries() const {
+    std::vector<DirEntry> result;
+    if (fd_ < 0) return result;
+    alignas(LinuxDirent64) char buf[32768];
+    for (;;) {
+        long n = ::syscall(SYS_getdents64, fd_, buf, sizeof(buf));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::filesystem::filesystem_error("cannot read directory", path_, std::error_code(errno, std::generic_category()));
+        }
+        if (n == 0) break;
+        for (long offset = 0; offset < n;) {
+            const auto* d = reinterpret_cast<const LinuxDirent64*>(buf + offset);
+            offset += d->d_reclen;
+            const char* name = d->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+            DirEntry entry{name, EntryKind::Other, false};
+            unsigned char type = d->d_type;
+            struct stat st;
+            if (type == DT_UNKNOWN) {
+                if (::fstatat(fd_, name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;  // vanished meanwhile
+                type = S_ISLNK(st.st_mode) ? DT_LNK : DT_UNKNOWN;
+                entry.kind = kind_of(st.st_mode);
+            }
+            if (type == DT_DIR) {
+                entry.kind = EntryKind::Directory;
+            } else if (type == DT_REG) {
+                entry.kind = EntryKind::File;
+            } else if (type == DT_LNK) {
+                entry.symlink = true;
+                entry.kind = ::fstatat(fd_, name, &st, 0) == 0 ? kind_of(st.st_mode) : EntryKind::Other;
+            }
+            result.push_back(std::move(entry));
+        }
+    }
+    return result;
+}
+
+#else
+
+DirectoryReader::DirectoryReader(const std::filesystem::path& path) : path_(path) {}
+
+DirectoryReader::DirectoryReader(const DirectoryReader& parent, const std::string& name) : path_(parent.path_ / name) {}
+
+DirectoryReader::~DirectoryReader() = default;
+
+void DirectoryReader::open_at(int, const char*, int) {}
+
+std::vector<DirEntry> DirectoryReader::entries() const {
+    std::vector<DirEntry> result;
+    for (const auto& e : std::filesystem::directory_iterator(path_, std::filesystem::directory_options::skip_permission_denied)) {
+        std::error_code ec;
+        EntryKind kind = EntryKind::Other;
+        if (e.is_directory(ec)) {
+            kind = EntryKind::Directory;
+        } else if (e.is_regular_file(ec)) {
+            kind = EntryKind::File;
+        }
+        result.push_back({e.path().filename().string(), kind, e.is_symlink(ec)});
+    }
+    return result;
+}
+
+#endif
+
+}  // namespace scaffolder
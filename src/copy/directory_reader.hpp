@@ -0,0 +1,50 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace scaffolder {
+
+enum class EntryKind {
+    Directory,
+    File,   // regular file, or a symlink to one
+    Other   // special file or dangling symlink
+};
+
+struct DirEntry {
+    std::string name;
+    EntryKind kind;
+    bool symlink;
+};
+
+/** One open source directory. On Linux the listing comes from getdents64 with types from d_type,
+ *  so a stat is only needed for symlinks and filesystems reporting DT_UNKNOWN, and subdirectories
+ *  open relative to the parent descriptor. Elsewhere std::filesystem is used. A directory that
+ *  cannot be read for lack of permission lists as empty; other errors throw filesystem_error. */
+class DirectoryReader {
+public:
+    explicit DirectoryReader(const std::filesystem::path& path);
+    DirectoryReader(const DirectoryReader& parent, const std::string& name);
+    ~DirectoryReader();
+    DirectoryReader(const DirectoryReader&) = delete;
+    DirectoryReader& operator=(const DirectoryReader&) = delete;
+
+    /** Entries except "." and "..", in directory order. */
+    std::vector<DirEntry> entries() const;
+
+    const std::filesystem::path& path() const { return path_; }
+
+private:
+    void open_at(int dir_fd, const char* name, int flags);
+
+    std::filesystem::path path_;
+    int fd_ = -1;
+};
+
+/** Appends name to a '/'-separated relative path. */
+inline std::string join_relative(const std::string& rel, const std::string& name) {
+    return rel.empty() ? name : rel + '/' + name;
+}
+
+}  // namespace scaffolder
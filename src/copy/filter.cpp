@@ -1,59 +1,155 @@
 #include "copy/filter.hpp"
 #include <algorithm>
-#include <regex>
 
 namespace scaffolder {
 
-Filter::Filter(const PathFilters& filters) : filters_(filters) {}
+GlobPattern::GlobPattern(const std::string& pattern) : pattern_(pattern) {
+    std::replace(pattern_.begin(), pattern_.end(), '\\', '/');
+    if (pattern_.find_first_of("[](){}+^$|") == std::string::npos) {
+        for (size_t i = 0; i < pattern_.size(); ++i) {
+            char c = pattern_[i];
+            if (c == '*' && i + 1 < pattern_.size() && pattern_[i + 1] == '*') {
+                steps_.push_back({Token::DoubleStar, 0});
+                ++i;
+            } else if (c == '*') {
+                steps_.push_back({Token::Star, 0});
+            } else if (c == '?') {
+                steps_.push_back({Token::Any, 0});
+            } else {
+                steps_.push_back({Token::Literal, c});
+            }
+        }
+        return;
+    }
 
-bool Filter::matches_glob(const std::string& pattern, const std::string& path_str) const {
-    std::string pat = pattern;
-    std::replace(pat.begin(), pat.end(), '\\', '/');
     std::string regex_pat;
-    for (size_t i = 0; i < pat.size(); ++i) {
-        if (pat[i] == '*') {
-            if (i + 1 < pat.size() && pat[i + 1] == '*') {
+    for (size_t i = 0; i < pattern_.size(); ++i) {
+        if (pattern_[i] == '*') {
+            if (i + 1 < pattern_.size() && pattern_[i + 1] == '*') {
                 regex_pat += ".*";
                 ++i;
             } else {
                 regex_pat += "[^/]*";
             }
-        } else if (pat[i] == '?') {
+        } else if (pattern_[i] == '?') {
             regex_pat += "[^/]";
-        } else if (pat[i] == '.') {
+        } else if (pattern_[i] == '.') {
             regex_pat += "\\.";
         } else {
-            regex_pat += pat[i];
+            regex_pat += pattern_[i];
         }
     }
     try {
-        std::regex re(regex_pat);
-        return std::regex_match(path_str, re);
+        regex_ = std::make_shared<const std::regex>(regex_pat);
     } catch (...) {
-        return path_str.find(pat) != std::string::npos;
+        substring_ = true;
     }
 }
 
-bool Filter::should_include(const std::filesystem::path& path, const std::filesystem::path& base) const {
+bool GlobPattern::matches(const std::string& path_str) const {
+    if (regex_) return std::regex_match(path_str, *regex_);
+    if (substring_) return path_str.find(pattern_) != std::string::npos;
+
+    // Runs the pattern as an NFA: states[i] means steps_[0, i) matched the input read so far.
+    const size_t n = steps_.size();
+    std::vector<char> states(n + 1, 0);
+    std::vector<char> next(n + 1, 0);
+    auto close = [this, n](std::vector<char>& set) {
+        for (size_t i = 0; i < n; ++i) {
+            if (set[i] && (steps_[i].token == Token::Star || steps_[i].token == Token::DoubleStar)) set[i + 1] = 1;
+        }
+    };
+    states[0] = 1;
+    close(states);
+    for (char c : path_str) {
+        std::fill(next.begin(), next.end(), 0);
+        bool any = false;
+        for (size_t i = 0; i < n; ++i) {
+            if (!states[i]) continue;
+            const Step& step = steps_[i];
+            switch (step.token) {
+            case Token::Literal:
+                if (step.ch == c) next[i + 1] = 1, any = true;
+                break;
+            case Token::Any:
+                if (c != '/') next[i + 1] = 1, any = true;
+                break;
+            case Token::Star:
+                if (c != '/') next[i] = 1, any = true;
+                break;
+            case Token::DoubleStar:
+                next[i] = 1, any = true;
+                break;
+            }
+        }
+        if (!any) return false;
+        close(next);
+        states.swap(next);
+    }
+    return states[n] != 0;
+}
+
+ExtensionSet::ExtensionSet(const std::vector<std::string>& extensions) { add(extensions); }
+
+void ExtensionSet::add(const std::vector<std::string>& extensions) {
+    for (const auto& e : extensions) {
+        if (e.empty()) continue;
+        if (e[0] == '*') {
+            extensions_.insert(e.substr(1));
+        } else {
+            extensions_.insert(e[0] == '.' ? e : "." + e);
+        }
+    }
+}
+
+bool ExtensionSet::matches(const std::filesystem::path& path) const {
+    return matches_name(path.filename().string());
+}
+
+bool ExtensionSet::matches_name(const std::string& filename) const {
+    if (extensions_.empty()) return false;
+    // Same rule as path::extension(): from the last dot, but a leading dot starts no extension.
+    size_t dot = filename.rfind('.');
+    if (dot == std::string::npos || dot == 0 || filename == "..") return false;
+    return extensions_.count(filename.substr(dot)) != 0;
+}
+
+Filter::Filter(const PathFilters& filters) : filters_(filters) {
+    for (const auto& inc : filters_.include_paths) include_globs_.emplace_back(inc);
+    for (const auto& exc : filters_.exclude_paths) exclude_globs_.emplace_back(exc);
+}
+
+std::string Filter::relative_string(const std::filesystem::path& path, const std::filesystem::path& base) const {
     std::filesystem::path rel;
     try {
         rel = std::filesystem::relative(path, base);
     } catch (...) {
         rel = path;
     }
-    std::string path_str = rel.generic_string();
+    return rel.generic_string();
+}
+
+bool Filter::should_include(const std::filesystem::path& path, const std::filesystem::path& base) const {
+    return includes_relative(relative_string(path, base));
+}
+
+bool Filter::includes_relative(const std::string& path_str) const {
     if (path_str.empty() || path_str == ".") return true;
 
     auto matches_include = [this, &path_str]() {
         if (filters_.include_paths.empty()) return true;
-        for (const auto& inc : filters_.include_paths) {
-            if (matches_glob(inc, path_str) || path_str.find(inc) != std::string::npos) return true;
+        for (size_t i = 0; i < include_globs_.size(); ++i) {
+            if (path_str.find(filters_.include_paths[i]) != std::string::npos || include_globs_[i].matches(path_str)) {
+                return true;
+            }
         }
         return false;
     };
     auto matches_exclude = [this, &path_str]() {
-        for (const auto& exc : filters_.exclude_paths) {
-            if (matches_glob(exc, path_str) || path_str.find(exc) != std::string::npos) return true;
+        for (size_t i = 0; i < exclude_globs_.size(); ++i) {
+            if (path_str.find(filters_.exclude_paths[i]) != std::string::npos || exclude_globs_[i].matches(path_str)) {
+                return true;
+            }
         }
         return false;
     };
@@ -68,20 +164,43 @@ bool Filter::should_include(const std::filesystem::path& path, const std::filesy
     }
 }
 
-bool Filter::matches_extension(const std::filesystem::path& path, const std::vector<std::string>& extensions) const {
-    std::string ext = path.extension().string();
-    if (ext.empty()) return false;
-    for (const auto& e : extensions) {
-        if (e.empty()) continue;
-        if (e[0] == '*') {
-            std::string suffix = e.substr(1);
-            if (suffix == ext || (suffix[0] == '.' && ext == suffix)) return true;
-        } else {
-            std::string e_ext = e[0] == '.' ? e : "." + e;
-            if (ext == e_ext) return true;
+bool Filter::prunes_directory(const std::filesystem::path& dir, const std::filesystem::path& base) const {
+    return prunes_relative(relative_string(dir, base));
+}
+
+bool Filter::prunes_relative(const std::string& dir_str) const {
+    // In ExcludeFirst mode an include pattern can rescue any excluded path, and include patterns
+    // match as substrings, so some path below the directory could always match one.
+    if (filters_.filter_mode == FilterMode::ExcludeFirst) return false;
+    if (dir_str.empty() || dir_str == ".") return false;
+
+    for (size_t i = 0; i < exclude_globs_.size(); ++i) {
+        const std::string& exc = filters_.exclude_paths[i];
+        if (exc.empty()) continue;
+        // Every path below contains the directory path, hence also this substring.
+        if (dir_str.find(exc) != std::string::npos) return true;
+        // "X**" matches "dir/" + anything once some prefix of "dir/" matches X.
+        const GlobPattern& glob = exclude_globs_[i];
+        if (!glob.is_regex() && exc.size() >= 2 && exc.compare(exc.size() - 2, 2, "**") == 0 &&
+            glob.matches(dir_str + "/")) {
+            return true;
         }
     }
     return false;
 }
 
+std::vector<std::string> Filter::sparse_exclusions() const {
+    std::vector<std::string> patterns;
+    // In ExcludeFirst mode an include pattern can rescue an excluded path.
+    if (filters_.filter_mode == FilterMode::ExcludeFirst) return patterns;
+    for (const auto& exc : filters_.exclude_paths) {
+        // A plain substring without '/' matches exactly the paths with a component containing it:
+        // that file name, or any directory above it.
+        if (exc.empty() || exc.find_first_of("/\\*?[](){}+^$|") != std::string::npos) continue;
+        patterns.push_back("!*" + exc + "*");
+        patterns.push_back("!**/*" + exc + "*/**");
+    }
+    return patterns;
+}
+
 }  // namespace scaffolder
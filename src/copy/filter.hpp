@@ -2,20 +2,75 @@
 
 #include "../metadata/schema.hpp"
 #include <filesystem>
+#include <memory>
+#include <regex>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 namespace scaffolder {
 
+/** A path glob compiled once: "**" matches anything, "*" and "?" stop at '/', other characters are
+ *  literal. Patterns using further regex syntax ("[a-z]", "(a|b)", ...) keep their regex meaning
+ *  through a regex built here; patterns that are not valid regexes match as substrings. */
+class GlobPattern {
+public:
+    explicit GlobPattern(const std::string& pattern);
+    bool matches(const std::string& path_str) const;
+    const std::string& pattern() const { return pattern_; }
+    /** True when the pattern fell back to regex or substring matching. */
+    bool is_regex() const { return regex_ != nullptr || substring_; }
+
+private:
+    enum class Token : char { Literal, Any, Star, DoubleStar };
+    struct Step {
+        Token token;
+        char ch;
+    };
+
+    std::string pattern_;
+    std::vector<Step> steps_;
+    std::shared_ptr<const std::regex> regex_;
+    bool substring_ = false;
+};
+
+/** Extension list ("*.c", ".c" or "c") compiled into one hash lookup on the path extension. */
+class ExtensionSet {
+public:
+    ExtensionSet() = default;
+    explicit ExtensionSet(const std::vector<std::string>& extensions);
+    void add(const std::vector<std::string>& extensions);
+    bool matches(const std::filesystem::path& path) const;
+    bool matches_name(const std::string& filename) const;
+    bool empty() const { return extensions_.empty(); }
+    /** Normalized extensions, each with its leading dot. */
+    const std::unordered_set<std::string>& extensions() const { return extensions_; }
+
+private:
+    std::unordered_set<std::string> extensions_;
+};
+
 class Filter {
 public:
     explicit Filter(const PathFilters& filters);
     bool should_include(const std::filesystem::path& path, const std::filesystem::path& base) const;
-    bool matches_extension(const std::filesystem::path& path, const std::vector<std::string>& extensions) const;
+    /** True when no path below dir can pass should_include, so a walker may skip the whole subtree. */
+    bool prunes_directory(const std::filesystem::path& dir, const std::filesystem::path& base) const;
+
+    /** should_include / prunes_directory for a '/'-separated path already relative to the base,
+     *  as produced by a walker; skips the std::filesystem::relative round trip. */
+    bool includes_relative(const std::string& rel) const;
+    bool prunes_relative(const std::string& rel) const;
+
+    /** Negated sparse-checkout patterns (gitignore syntax) for the exclude paths that can be
+     *  expressed exactly; every path they drop is one should_include rejects. */
+    std::vector<std::string> sparse_exclusions() const;
 
 private:
-    bool matches_glob(const std::string& pattern, const std::string& path_str) const;
+    std::string relative_string(const std::filesystem::path& path, const std::filesystem::path& base) const;
     PathFilters filters_;
+    std::vector<GlobPattern> include_globs_;
+    std::vector<GlobPattern> exclude_globs_;
 };
 
 }  // namespace scaffolder
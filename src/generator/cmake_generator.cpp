@@ -1,84 +1,113 @@
 #include "generator/cmake_generator.hpp"
+#include "generator/native_emitters.hpp"
 #include "generator/template_engine.hpp"
 #include <nlohmann/json.hpp>
 #include <fstream>
 #include <algorithm>
-#include <map>
+#include <utility>
 
 namespace scaffolder {
 
-CmakeGenerator::CmakeGenerator(const Metadata& metadata, PathResolver& resolver, const std::filesystem::path& output_root)
-    : metadata_(metadata), resolver_(resolver), output_root_(output_root) {}
+CmakeGenerator::CmakeGenerator(const MetadataIndex& index, PathResolver& resolver, const std::filesystem::path& output_root)
+    : index_(index), metadata_(index.metadata()), resolver_(resolver), output_root_(output_root) {}
 
-void CmakeGenerator::generate_all() {
+static nlohmann::json comp_to_json(const SwComponent& comp, const ConditionEvaluator* cond_eval) {
+    nlohmann::json j;
+    j["id"] = comp.id;
+    j["library_type"] = library_type_of(comp);
+    j["source_extensions"] = source_extensions_of(comp);
+    j["include_extensions"] = include_extensions_of(comp);
+    j["dependencies"] = dependencies_of(comp);
+    if (comp.condition && cond_eval) {
+        j["condition_cmake"] = cond_eval->to_cmake_if(*comp.condition);
+    }
+    return j;
+}
+
+// [path] or [path, condition], as the subdirectory loops of the templates expect.
+static nlohmann::json subdirs_to_json(const std::vector<Subdir>& subdirs) {
+    nlohmann::json j = nlohmann::json::array();
+    for (const auto& [path, condition] : subdirs) {
+        if (condition)
+            j.push_back(nlohmann::json::array({path, *condition}));
+        else
+            j.push_back(nlohmann::json::array({path}));
+    }
+    return j;
+}
+
+void CmakeGenerator::generate_all(const RenderHooks& hooks, unsigned jobs) {
+    // Jobs are collected here, serially; emitting or rendering and writing the files runs on the pool.
+    pending_.clear();
     generate_root_cmakelists();
     generate_cmake_helpers();
+    std::vector<const SwComponent*> rendered;
     for (const auto& comp : metadata_.source_tree.components) {
         if (comp.type == "external") continue;
+        if (hooks.is_current && hooks.is_current(comp)) continue;
         generate_component_cmakelists(comp);
+        rendered.push_back(&comp);
+    }
+    std::vector<RenderJob> pending = std::move(pending_);
+    pending_.clear();
+    TemplateEngine::shared().render_all(pending, jobs);
+    if (hooks.rendered) {
+        for (const SwComponent* comp : rendered) hooks.rendered(*comp);
     }
 }
 
-void CmakeGenerator::generate_root_cmakelists() {
-    std::map<std::string, std::string> comp_dest;
-    std::map<std::string, std::optional<Condition>> comp_condition;
-    for (const auto& c : metadata_.source_tree.components) {
-        if (c.dest && c.type != "external") {
-            comp_dest[c.id] = *c.dest;
-            comp_condition[c.id] = c.condition;
-        }
-    }
+void CmakeGenerator::queue(const std::string& template_name, nlohmann::json data,
+                           const std::filesystem::path& output_path) {
+    pending_.push_back({template_name, std::move(data), output_path, nullptr});
+}
 
-    nlohmann::json subdirs_json = nlohmann::json::array();
-    const SwComponent* root_layer = nullptr;
-    for (const auto& c : metadata_.source_tree.components) {
-        if (c.type == "layer" && c.id == "root_layer") {
-            root_layer = &c;
-            break;
-        }
-    }
+void CmakeGenerator::queue(const std::string& template_name, const std::filesystem::path& output_path,
+                           std::function<void(std::string&)> emit,
+                           const std::function<nlohmann::json()>& make_data) {
+    pending_.push_back(TemplateEngine::shared().make_job(template_name, output_path, std::move(emit), make_data));
+}
 
-    if (root_layer && root_layer->subdirs) {
-        for (const auto& sub : *root_layer->subdirs) {
-            auto it = comp_dest.find(sub);
-            if (it != comp_dest.end() && it->second != ".") {
-                auto cond_it = comp_condition.find(sub);
-                std::string cond_cmake;
-                if (cond_it != comp_condition.end() && cond_it->second) {
-                    cond_cmake = cond_eval_.to_cmake_if(*cond_it->second);
-                }
-                if (cond_cmake.empty())
-                    subdirs_json.push_back(nlohmann::json::array({it->second}));
-                else
-                    subdirs_json.push_back(nlohmann::json::array({it->second, cond_cmake}));
-            }
+void CmakeGenerator::generate_root_cmakelists() {
+    std::vector<Subdir> subdirs;
+    const SwComponent* root_layer = index_.component("root_layer");
+    if (root_layer && root_layer->type == "layer" && root_layer->subdirs) {
+        for (const SwComponent* sub : index_.children(root_layer->id)) {
+            if (!sub->dest || sub->type == "external" || *sub->dest == ".") continue;
+            subdirs.emplace_back(*sub->dest, condition_cmake(*sub));
         }
     } else {
         for (const auto& c : metadata_.source_tree.components) {
-            if (c.type == "layer" && c.dest && *c.dest != ".") {
-                std::string cond_cmake;
-                if (c.condition) cond_cmake = cond_eval_.to_cmake_if(*c.condition);
-                subdirs_json.push_back(nlohmann::json::array({*c.dest, cond_cmake}));
-            }
+            // Every layer gets a condition here, even an empty one, whose if() CMake never enters; this
+            // is what the root CMakeLists has always contained without a root_layer.
+            if (c.type == "layer" && c.dest && *c.dest != ".")
+                subdirs.emplace_back(*c.dest, condition_cmake(c).value_or(std::string()));
         }
     }
 
-    nlohmann::json data;
-    data["project"]["name"] = metadata_.project.name;
-    data["project"]["version"] = metadata_.project.version;
-    data["cmake_minimum"]["major"] = metadata_.project.cmake_minimum.major;
-    data["cmake_minimum"]["minor"] = metadata_.project.cmake_minimum.minor;
-    data["cmake_minimum"]["patch"] = metadata_.project.cmake_minimum.patch;
-    data["subdirs"] = subdirs_json;
+    queue("root_cmakelists.jinja2", output_root_ / "CMakeLists.txt",
+          [this, subdirs](std::string& out) { emit_root_cmakelists(out, metadata_.project, subdirs); },
+          [&] {
+              nlohmann::json data;
+              data["project"]["name"] = metadata_.project.name;
+              data["project"]["version"] = metadata_.project.version;
+              data["cmake_minimum"]["major"] = metadata_.project.cmake_minimum.major;
+              data["cmake_minimum"]["minor"] = metadata_.project.cmake_minimum.minor;
+              data["cmake_minimum"]["patch"] = metadata_.project.cmake_minimum.patch;
+              data["subdirs"] = subdirs_to_json(subdirs);
+              return data;
+          });
+}
 
-    TemplateEngine engine;
-    engine.render_to_file("root_cmakelists.jinja2", data, output_root_ / "CMakeLists.txt");
+std::optional<std::string> CmakeGenerator::condition_cmake(const SwComponent& comp) const {
+    if (!comp.condition) return std::nullopt;
+    std::string cmake = cond_eval_.to_cmake_if(*comp.condition);
+    if (cmake.empty()) return std::nullopt;
+    return cmake;
 }
 
 void CmakeGenerator::generate_cmake_helpers() {
     std::filesystem::create_directories(output_root_ / "cmake");
-    TemplateEngine engine;
-    engine.render_to_file("cmake/AddHierarchicalLibrary.cmake", {}, output_root_ / "cmake" / "AddHierarchicalLibrary.cmake");
+    queue("cmake/AddHierarchicalLibrary.cmake", {}, output_root_ / "cmake" / "AddHierarchicalLibrary.cmake");
 }
 
 void CmakeGenerator::generate_component_cmakelists(const SwComponent& comp) {
@@ -102,94 +131,66 @@ void CmakeGenerator::generate_component_cmakelists(const SwComponent& comp) {
     }
 }
 
-static nlohmann::json comp_to_json(const SwComponent& comp, ConditionEvaluator* cond_eval) {
-    nlohmann::json j;
-    j["id"] = comp.id;
-    j["library_type"] = comp.library_type.value_or("static");
-    j["source_extensions"] = comp.source_extensions.value_or(std::vector<std::string>{"*.c", "*.cpp", "*.cc"});
-    j["include_extensions"] = comp.include_extensions.value_or(std::vector<std::string>{"*.h", "*.hpp"});
-    j["dependencies"] = comp.dependencies.value_or(std::vector<std::string>{});
-    if (comp.condition && cond_eval) {
-        j["condition_cmake"] = cond_eval->to_cmake_if(*comp.condition);
-    }
-    return j;
-}
-
 void CmakeGenerator::generate_library(const SwComponent& comp, const std::filesystem::path& dest) {
-    nlohmann::json data = comp_to_json(comp, &cond_eval_);
-    TemplateEngine engine;
-    engine.render_to_file("library_cmakelists.jinja2", data, dest / "CMakeLists.txt");
+    queue("library_cmakelists.jinja2", dest / "CMakeLists.txt",
+          [this, &comp](std::string& out) { emit_library_cmakelists(out, comp, cond_eval_); },
+          [&] { return comp_to_json(comp, &cond_eval_); });
 }
 
 void CmakeGenerator::generate_hierarchical_library(const SwComponent& comp, const std::filesystem::path& dest) {
-    nlohmann::json data = comp_to_json(comp, &cond_eval_);
-    TemplateEngine engine;
-    engine.render_to_file("hierarchical_library_cmakelists.jinja2", data, dest / "CMakeLists.txt");
+    queue("hierarchical_library_cmakelists.jinja2", dest / "CMakeLists.txt",
+          [this, &comp](std::string& out) { emit_hierarchical_library_cmakelists(out, comp, cond_eval_); },
+          [&] { return comp_to_json(comp, &cond_eval_); });
 }
 
 void CmakeGenerator::generate_executable(const SwComponent& comp, const std::filesystem::path& dest) {
-    nlohmann::json data = comp_to_json(comp, &cond_eval_);
-    TemplateEngine engine;
-    engine.render_to_file("executable_cmakelists.jinja2", data, dest / "CMakeLists.txt");
+    queue("executable_cmakelists.jinja2", dest / "CMakeLists.txt",
+          [this, &comp](std::string& out) { emit_executable_cmakelists(out, comp, cond_eval_); },
+          [&] { return comp_to_json(comp, &cond_eval_); });
 }
 
 void CmakeGenerator::generate_variant(const SwComponent& comp, const std::filesystem::path& dest) {
     if (!comp.variations || comp.variations->empty()) return;
 
-    nlohmann::json data;
-    data["id"] = comp.id;
-    data["variations"] = nlohmann::json::array();
-    for (const auto& v : *comp.variations) {
-        nlohmann::json var;
-        var["subdir"] = v.subdir;
-        var["condition_cmake"] = cond_eval_.to_cmake_if(v.condition);
-        data["variations"].push_back(var);
-    }
-
-    TemplateEngine engine;
-    engine.render_to_file("variant_cmakelists.jinja2", data, dest / "CMakeLists.txt");
+    queue("variant_cmakelists.jinja2", dest / "CMakeLists.txt",
+          [this, &comp](std::string& out) { emit_variant_cmakelists(out, comp, cond_eval_); },
+          [&] {
+              nlohmann::json data;
+              data["id"] = comp.id;
+              data["variations"] = nlohmann::json::array();
+              for (const auto& v : *comp.variations) {
+                  nlohmann::json var;
+                  var["subdir"] = v.subdir;
+                  var["condition_cmake"] = cond_eval_.to_cmake_if(v.condition);
+                  data["variations"].push_back(var);
+              }
+              return data;
+          });
 }
 
 void CmakeGenerator::generate_layer(const SwComponent& comp, const std::filesystem::path& dest) {
-    std::map<std::string, std::string> comp_dest;
-    std::map<std::string, std::optional<Condition>> comp_condition;
-    for (const auto& c : metadata_.source_tree.components) {
-        if (c.dest && c.type != "external") {
-            comp_dest[c.id] = *c.dest;
-            comp_condition[c.id] = c.condition;
+    std::vector<Subdir> subdirs;
+    for (const SwComponent* sub : index_.children(comp.id)) {
+        if (!sub->dest || sub->type == "external") continue;
+        const std::string& subpath = *sub->dest;
+        std::filesystem::path sub_full(output_root_ / subpath);
+        std::filesystem::path rel;
+        try {
+            rel = std::filesystem::relative(sub_full, dest);
+        } catch (...) {
+            rel = subpath;
         }
+        subdirs.emplace_back(rel.generic_string(), condition_cmake(*sub));
     }
 
-    nlohmann::json subdirs_json = nlohmann::json::array();
-    for (const auto& sub : comp.subdirs.value_or(std::vector<std::string>{})) {
-        auto it = comp_dest.find(sub);
-        if (it != comp_dest.end()) {
-            std::string subpath = it->second;
-            std::filesystem::path sub_full(output_root_ / subpath);
-            std::filesystem::path rel;
-            try {
-                rel = std::filesystem::relative(sub_full, dest);
-            } catch (...) {
-                rel = subpath;
-            }
-            std::string cond_cmake;
-            auto cond_it = comp_condition.find(sub);
-            if (cond_it != comp_condition.end() && cond_it->second) {
-                cond_cmake = cond_eval_.to_cmake_if(*cond_it->second);
-            }
-            if (cond_cmake.empty())
-                subdirs_json.push_back(nlohmann::json::array({rel.generic_string()}));
-            else
-                subdirs_json.push_back(nlohmann::json::array({rel.generic_string(), cond_cmake}));
-        }
-    }
-
-    nlohmann::json data;
-    data["subdirs"] = subdirs_json;
-    if (comp.condition) data["condition_cmake"] = cond_eval_.to_cmake_if(*comp.condition);
-
-    TemplateEngine engine;
-    engine.render_to_file("layer_cmakelists.jinja2", data, dest / "CMakeLists.txt");
+    queue("layer_cmakelists.jinja2", dest / "CMakeLists.txt",
+          [this, &comp, subdirs](std::string& out) { emit_layer_cmakelists(out, comp, subdirs, cond_eval_); },
+          [&] {
+              nlohmann::json data;
+              data["subdirs"] = subdirs_to_json(subdirs);
+              if (comp.condition) data["condition_cmake"] = cond_eval_.to_cmake_if(*comp.condition);
+              return data;
+          });
 }
 
 std::string CmakeGenerator::collect_sources(const std::filesystem::path& dir, const std::vector<std::string>& exts) {
@@ -1,17 +1,28 @@
 #pragma once
 
-#include "../metadata/schema.hpp"
+#include "../metadata/metadata_index.hpp"
 #include "condition_evaluator.hpp"
+#include "template_engine.hpp"
 #include "../resolver/path_resolver.hpp"
 #include <filesystem>
+#include <functional>
+#include <optional>
 #include <string>
 
 namespace scaffolder {
 
+/** Lets a caller skip component CMakeLists.txt renders it knows are current (resumed runs).
+ *  rendered is called in metadata order once all files are written. */
+struct RenderHooks {
+    std::function<bool(const SwComponent&)> is_current;
+    std::function<void(const SwComponent&)> rendered;
+};
+
 class CmakeGenerator {
 public:
-    CmakeGenerator(const Metadata& metadata, PathResolver& resolver, const std::filesystem::path& output_root);
-    void generate_all();
+    CmakeGenerator(const MetadataIndex& index, PathResolver& resolver, const std::filesystem::path& output_root);
+    /** Renders on up to jobs workers (0 = one per hardware thread); the output does not depend on jobs. */
+    void generate_all(const RenderHooks& hooks = {}, unsigned jobs = 1);
 
 private:
     void generate_root_cmakelists();
@@ -22,13 +33,21 @@ private:
     void generate_executable(const SwComponent& comp, const std::filesystem::path& dest);
     void generate_variant(const SwComponent& comp, const std::filesystem::path& dest);
     void generate_layer(const SwComponent& comp, const std::filesystem::path& dest);
+    /** The CMake if() expression guarding comp; none when it has no (or an empty) condition. */
+    std::optional<std::string> condition_cmake(const SwComponent& comp) const;
+    void queue(const std::string& template_name, nlohmann::json data, const std::filesystem::path& output_path);
+    /** Queues a built-in template's native emitter; make_data only runs when the template is overridden. */
+    void queue(const std::string& template_name, const std::filesystem::path& output_path,
+               std::function<void(std::string&)> emit, const std::function<nlohmann::json()>& make_data);
     std::string collect_sources(const std::filesystem::path& dir, const std::vector<std::string>& exts);
     std::vector<std::filesystem::path> collect_include_dirs(const std::filesystem::path& dir, const std::vector<std::string>& exts);
 
+    const MetadataIndex& index_;
     const Metadata& metadata_;
     PathResolver& resolver_;
     std::filesystem::path output_root_;
     ConditionEvaluator cond_eval_;
+    std::vector<RenderJob> pending_;  // collected by generate_all, rendered together
 };
 
 }  // namespace scaffolder
@@ -4,7 +4,7 @@
 
 namespace scaffolder {
 
-ConanGenerator::ConanGenerator(const Metadata& metadata) : metadata_(metadata) {}
+ConanGenerator::ConanGenerator(const MetadataIndex& index) : metadata_(index.metadata()) {}
 
 void ConanGenerator::generate(const std::filesystem::path& output_root) {
     nlohmann::json data;
@@ -19,7 +19,7 @@ void ConanGenerator::generate(const std::filesystem::path& output_root) {
     }
     data["tool_requires"] = metadata_.dependencies.tool_requires;
 
-    TemplateEngine engine;
+    const TemplateEngine& engine = TemplateEngine::shared();
     engine.render_to_file("conanfile.jinja2", data, output_root / "conanfile.txt");
 }
 
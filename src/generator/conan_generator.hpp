@@ -1,13 +1,13 @@
 #pragma once
 
-#include "../metadata/schema.hpp"
+#include "../metadata/metadata_index.hpp"
 #include <filesystem>
 
 namespace scaffolder {
 
 class ConanGenerator {
 public:
-    explicit ConanGenerator(const Metadata& metadata);
+    explicit ConanGenerator(const MetadataIndex& index);
     void generate(const std::filesystem::path& output_root);
 
 private:
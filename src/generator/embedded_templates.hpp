@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+
+namespace scaffolder {
+
+/** A file of templates/ compiled into the executable by cmake/EmbedTemplates.cmake. */
+struct EmbeddedTemplate {
+    const char* name;           // path relative to templates/, '/'-separated
+    const unsigned char* data;  // size bytes followed by a NUL
+    size_t size;
+};
+
+/** Built-in templates, sorted by name. */
+extern const EmbeddedTemplate kEmbeddedTemplates[];
+extern const size_t kEmbeddedTemplateCount;
+
+}  // namespace scaffolder
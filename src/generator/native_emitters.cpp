@@ -0,0 +1,288 @@
+#include "generator/native_emitters.hpp"
+#include <cctype>
+
+// Every emitter transliterates its template as inja renders it (no trim_blocks / lstrip_blocks):
+// the newline after each {% ... %} tag is kept, which is where the blank lines of the output come from.
+
+namespace scaffolder {
+
+namespace {
+
+void append_upper(std::string& out, const std::string& s) {
+    for (unsigned char c : s) out += static_cast<char>(std::toupper(c));
+}
+
+void append_each(std::string& out, const std::vector<std::string>& items, const char* before, const char* after) {
+    for (const auto& item : items) {
+        out += before;
+        out += item;
+        out += after;
+    }
+}
+
+// {% if exists("condition_cmake") %}\nif({{ condition_cmake }})\n{% endif %}\n
+void open_condition(std::string& out, const SwComponent& comp, const ConditionEvaluator& cond_eval) {
+    if (comp.condition) {
+        out += "\nif(";
+        out += cond_eval.to_cmake_if(*comp.condition);
+        out += ")\n";
+    }
+    out += '\n';
+}
+
+// {% if exists("condition_cmake") %}\nendif()\n{% endif %}\n
+void close_condition(std::string& out, const SwComponent& comp) {
+    if (comp.condition) out += "\nendif()\n";
+    out += '\n';
+}
+
+// The subdirectory loop of layer_cmakelists.jinja2 and root_cmakelists.jinja2.
+void append_subdirs(std::string& out, const std::vector<Subdir>& subdirs) {
+    for (const auto& [path, condition] : subdirs) {
+        out += '\n';
+        if (condition) {
+            out += "\nif(";
+            out += *condition;
+            out += ")\n  add_subdirectory(";
+            out += path;
+            out += ")\nendif()\n";
+        } else {
+            out += "\nadd_subdirectory(";
+            out += path;
+            out += ")\n";
+        }
+        out += '\n';
+    }
+}
+
+// library_cmakelists.jinja2 and executable_cmakelists.jinja2, which differ in one line.
+void emit_target(std::string& out, const SwComponent& comp, const ConditionEvaluator& cond_eval, bool library) {
+    open_condition(out, comp, cond_eval);
+    out += "file(GLOB_RECURSE SRCS";
+    append_each(out, source_extensions_of(comp), " ", "");
+    if (library) {
+        out += ")\nadd_library(";
+        out += comp.id;
+        out += ' ';
+        append_upper(out, library_type_of(comp));
+    } else {
+        out += ")\nadd_executable(";
+        out += comp.id;
+    }
+    out += " ${SRCS})\ntarget_include_directories(";
+    out += comp.id;
+    out += " PRIVATE ${CMAKE_CURRENT_SOURCE_DIR} ${CMAKE_CURRENT_SOURCE_DIR}/include)\n";
+    const auto& deps = dependencies_of(comp);
+    if (!deps.empty()) {
+        out += "\ntarget_link_libraries(";
+        out += comp.id;
+        out += " PRIVATE";
+        append_each(out, deps, " ", "");
+        out += ")\n";
+    }
+    out += '\n';
+    close_condition(out, comp);
+}
+
+}  // namespace
+
+const std::string& library_type_of(const SwComponent& comp) {
+    static const std::string kDefault = "static";
+    return comp.library_type ? *comp.library_type : kDefault;
+}
+
+const std::vector<std::string>& source_extensions_of(const SwComponent& comp) {
+    static const std::vector<std::string> kDefault{"*.c", "*.cpp", "*.cc"};
+    return comp.source_extensions ? *comp.source_extensions : kDefault;
+}
+
+const std::vector<std::string>& include_extensions_of(const SwComponent& comp) {
+    static const std::vector<std::string> kDefault{"*.h", "*.hpp"};
+    return comp.include_extensions ? *comp.include_extensions : kDefault;
+}
+
+const std::vector<std::string>& dependencies_of(const SwComponent& comp) {
+    static const std::vector<std::string> kDefault;
+    return comp.dependencies ? *comp.dependencies : kDefault;
+}
+
+void emit_library_cmakelists(std::string& out, const SwComponent& comp, const ConditionEvaluator& cond_eval) {
+    emit_target(out, comp, cond_eval, true);
+}
+
+void emit_executable_cmakelists(std::string& out, const SwComponent& comp, const ConditionEvaluator& cond_eval) {
+    emit_target(out, comp, cond_eval, false);
+}
+
+void emit_hierarchical_library_cmakelists(std::string& out, const SwComponent& comp, const ConditionEvaluator& cond_eval) {
+    open_condition(out, comp, cond_eval);
+    out += "add_hierarchical_library(";
+    out += comp.id;
+    out += ' ';
+    append_upper(out, library_type_of(comp));
+    out += "\n  SOURCE_EXTENSIONS ";
+    append_each(out, source_extensions_of(comp), "", " ");
+    out += "\n  INCLUDE_EXTENSIONS ";
+    append_each(out, include_extensions_of(comp), "", " ");
+    out += "\n  ";
+    const auto& deps = dependencies_of(comp);
+    if (!deps.empty()) {
+        out += "LINK_LIBRARIES ";
+        append_each(out, deps, "", " ");
+    }
+    out += "\n)\n";
+    close_condition(out, comp);
+}
+
+void emit_variant_cmakelists(std::string& out, const SwComponent& comp, const ConditionEvaluator& cond_eval) {
+    if (comp.variations) {
+        bool first = true;
+        for (const auto& v : *comp.variations) {
+            out += first ? "\nif(" : "\nelseif(";
+            out += cond_eval.to_cmake_if(v.condition);
+            out += ")\n\n    add_subdirectory(";
+            out += v.subdir;
+            out += ")\n";
+            first = false;
+        }
+    }
+    out += "\nelse()\n    message(FATAL_ERROR \"No matching variant for ";
+    out += comp.id;
+    out += "\")\nendif()\n";
+}
+
+void emit_layer_cmakelists(std::string& out, const SwComponent& comp, const std::vector<Subdir>& subdirs,
+                           const ConditionEvaluator& cond_eval) {
+    open_condition(out, comp, cond_eval);
+    append_subdirs(out, subdirs);
+    out += '\n';
+    close_condition(out, comp);
+}
+
+void emit_root_cmakelists(std::string& out, const Project& project, const std::vector<Subdir>& subdirs) {
+    out += "cmake_minimum_required(VERSION ";
+    out += std::to_string(project.cmake_minimum.major);
+    out += '.';
+    out += std::to_string(project.cmake_minimum.minor);
+    out += ")\nproject(";
+    out += project.name;
+    out += " VERSION ";
+    out += project.version;
+    out += " LANGUAGES C CXX ASM)\n"
+           "\n"
+           "include(${CMAKE_CURRENT_SOURCE_DIR}/cmake/AddHierarchicalLibrary.cmake)\n"
+           "\n"
+           "# Preset variables (set by CMakePresets) - reference to avoid \"unused variable\" warning\n"
+           "message(STATUS \"Configuration: BOARD=${BOARD} SOC=${SOC} ISA_VARIANT=${ISA_VARIANT} BUILD_VARIANT=${BUILD_VARIANT}\")\n"
+           "\n";
+    append_subdirs(out, subdirs);
+    out += '\n';
+}
+
+void emit_toolchain(std::string& out, const Toolchain& tc, const std::string& processor,
+                    const std::map<std::string, std::vector<std::string>>& flags) {
+    out += "# Toolchain: ";
+    out += tc.display_name;
+    out += "\nset(CMAKE_SYSTEM_NAME Generic)\nset(CMAKE_SYSTEM_PROCESSOR ";
+    out += processor;
+    out += ")\n"
+           "\n"
+           "# Bare-metal: avoid full executable link in compiler checks (no syscall stubs)\n"
+           "set(CMAKE_TRY_COMPILE_TARGET_TYPE STATIC_LIBRARY)\n"
+           "\n"
+           "set(CMAKE_C_COMPILER \"";
+    out += tc.compiler.c;
+    out += "\")\nset(CMAKE_CXX_COMPILER \"";
+    out += tc.compiler.cxx;
+    out += "\")\nset(CMAKE_ASM_COMPILER \"";
+    out += tc.compiler.asm_;
+    out += "\")\n\n";
+
+    static const std::pair<const char*, const char*> kFlagVars[] = {
+        {"c", "C"}, {"cxx", "CXX"}, {"asm", "ASM"}, {"linker", "EXE_LINKER"}};
+    for (const auto& [type, var] : kFlagVars) {
+        auto it = flags.find(type);
+        if (it != flags.end() && !it->second.empty()) {
+            out += "\nset(CMAKE_";
+            out += var;
+            out += "_FLAGS \"";
+            append_each(out, it->second, "", " ");
+            out += "\")\n";
+        }
+        out += '\n';
+    }
+    out += '\n';
+
+    // The template is given the sysroot even when it is empty, and inja treats any string as true,
+    // so these lines are written for every toolchain.
+    out += "\nset(CMAKE_SYSROOT \"";
+    out += tc.sysroot;
+    out += "\")\nset(CMAKE_FIND_ROOT_PATH \"";
+    out += tc.sysroot;
+    out += "\")\n\n\n";
+    if (!tc.defines.empty()) {
+        out += "\nadd_compile_definitions(";
+        append_each(out, tc.defines, " ", "");
+        out += ")\n";
+    }
+    out += "\n\n";
+    if (!tc.lib_paths.empty()) {
+        out += "\nset(CMAKE_EXE_LINKER_FLAGS \"${CMAKE_EXE_LINKER_FLAGS}";
+        append_each(out, tc.lib_paths, " -L", "");
+        out += "\")\n";
+    }
+    out += '\n';
+    if (!tc.libs.empty()) {
+        out += "\nset(CMAKE_EXE_LINKER_FLAGS \"${CMAKE_EXE_LINKER_FLAGS}";
+        append_each(out, tc.libs, " -l", "");
+        out += "\")\n";
+    }
+    out += '\n';
+}
+
+void emit_cmake_presets(std::string& out, const CmakeVersion& cmake_minimum, const std::vector<ConfiguredPreset>& presets) {
+    out += "{\n  \"version\": 6,\n  \"cmakeMinimumRequired\": {\n    \"major\": ";
+    out += std::to_string(cmake_minimum.major);
+    out += ",\n    \"minor\": ";
+    out += std::to_string(cmake_minimum.minor);
+    out += ",\n    \"patch\": ";
+    out += std::to_string(cmake_minimum.patch);
+    out += "\n  },\n  \"configurePresets\": [\n";
+    for (size_t i = 0; i < presets.size(); ++i) {
+        const ConfiguredPreset& p = presets[i];
+        const PresetCombination& c = *p.combination;
+        out += "\n    {\n      \"name\": \"";
+        out += c.preset_name;
+        out += "\",\n      \"displayName\": \"";
+        out += c.preset_name;
+        out += "\",\n      \"generator\": \"Ninja\",\n      \"binaryDir\": \"";
+        out += p.binary_dir;
+        out += "\",\n      \"toolchainFile\": \"";
+        out += p.toolchain_file;
+        out += "\",\n      \"cacheVariables\": {\n        \"BOARD\": \"";
+        out += c.board;
+        out += "\",\n        \"SOC\": \"";
+        out += c.soc;
+        out += "\",\n        \"ISA_VARIANT\": \"";
+        out += c.isa_variant;
+        out += "\",\n        \"BUILD_VARIANT\": \"";
+        out += c.build_variant;
+        out += "\"\n      }\n    }";
+        if (i + 1 < presets.size()) out += ',';
+        out += "\n\n";
+    }
+    out += "\n  ],\n  \"buildPresets\": [\n";
+    for (size_t i = 0; i < presets.size(); ++i) {
+        const std::string& name = presets[i].combination->preset_name;
+        out += "\n    {\n      \"name\": \"";
+        out += name;
+        out += "\",\n      \"configurePreset\": \"";
+        out += name;
+        out += "\"\n    }";
+        if (i + 1 < presets.size()) out += ',';
+        out += "\n\n";
+    }
+    out += "\n  ]\n}\n";
+}
+
+}  // namespace scaffolder
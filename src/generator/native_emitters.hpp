@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../metadata/schema.hpp"
+#include "condition_evaluator.hpp"
+#include "preset_generator.hpp"
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace scaffolder {
+
+/** Native equivalents of the built-in templates, used while the override directory does not replace
+ *  them. Each appends to out exactly what its template renders from the data the generators build
+ *  for it, without building that data as JSON or interpreting the template. Keep them in step with
+ *  templates/: native_emitters_test renders every template both ways and compares the files. */
+
+/** A subdirectory and the CMake condition guarding it (none: unconditional). A present but empty
+ *  condition still renders an if() guard, which CMake evaluates as false. */
+using Subdir = std::pair<std::string, std::optional<std::string>>;
+
+/** Component fields with the defaults the templates are given. */
+const std::string& library_type_of(const SwComponent& comp);
+const std::vector<std::string>& source_extensions_of(const SwComponent& comp);
+const std::vector<std::string>& include_extensions_of(const SwComponent& comp);
+const std::vector<std::string>& dependencies_of(const SwComponent& comp);
+
+void emit_library_cmakelists(std::string& out, const SwComponent& comp, const ConditionEvaluator& cond_eval);
+void emit_hierarchical_library_cmakelists(std::string& out, const SwComponent& comp, const ConditionEvaluator& cond_eval);
+void emit_executable_cmakelists(std::string& out, const SwComponent& comp, const ConditionEvaluator& cond_eval);
+void emit_variant_cmakelists(std::string& out, const SwComponent& comp, const ConditionEvaluator& cond_eval);
+void emit_layer_cmakelists(std::string& out, const SwComponent& comp, const std::vector<Subdir>& subdirs,
+                           const ConditionEvaluator& cond_eval);
+void emit_root_cmakelists(std::string& out, const Project& project, const std::vector<Subdir>& subdirs);
+/** flags holds the merged flags by type (c, cxx, asm, linker); a missing type has no flags. */
+void emit_toolchain(std::string& out, const Toolchain& tc, const std::string& processor,
+                    const std::map<std::string, std::vector<std::string>>& flags);
+void emit_cmake_presets(std::string& out, const CmakeVersion& cmake_minimum, const std::vector<ConfiguredPreset>& presets);
+
+}  // namespace scaffolder
@@ -1,17 +1,26 @@
 #include "generator/preset_generator.hpp"
+#include "generator/native_emitters.hpp"
 #include "generator/template_engine.hpp"
 #include <nlohmann/json.hpp>
 #include <algorithm>
+#include <unordered_map>
+#include <utility>
 
 namespace scaffolder {
 
-PresetGenerator::PresetGenerator(const Metadata& metadata) : metadata_(metadata) {}
+PresetGenerator::PresetGenerator(const MetadataIndex& index) : index_(index), metadata_(index.metadata()) {}
 
 std::string PresetGenerator::get_toolchain_for_isa(const std::string& isa) const {
+    const IsaVariant* iv = index_.isa_variant(isa);
+    return iv ? iv->toolchain : "";
+}
+
+std::string PresetGenerator::isa_variant_for(const std::string& isa) const {
+    // The first ISA variant named isa or mentioning it in its display name, else isa itself.
     for (const auto& iv : metadata_.isa_variants) {
-        if (iv.id == isa) return iv.toolchain;
+        if (iv.id == isa || iv.display_name.find(isa) != std::string::npos) return iv.id;
     }
-    return "";
+    return isa;
 }
 
 bool PresetGenerator::is_excluded(const PresetCombination& c) const {
@@ -25,31 +34,29 @@ bool PresetGenerator::is_excluded(const PresetCombination& c) const {
     return false;
 }
 
-std::vector<PresetCombination> PresetGenerator::compute_combinations() {
+std::vector<PresetCombination> PresetGenerator::compute_combinations() const {
     std::vector<PresetCombination> result;
+    // SoCs share ISAs, so each ISA is matched to its variant and toolchain once.
+    std::unordered_map<std::string, std::pair<std::string, std::string>> isa_matches;
     for (const auto& board : metadata_.boards) {
         for (const auto& soc_id : board.socs) {
-            const Soc* soc = nullptr;
-            for (const auto& s : metadata_.socs) {
-                if (s.id == soc_id) { soc = &s; break; }
-            }
+            const Soc* soc = index_.soc(soc_id);
             if (!soc) continue;
             for (const auto& isa : soc->isas) {
-                std::string isa_variant_id;
-                for (const auto& iv : metadata_.isa_variants) {
-                    if (iv.id == isa || iv.display_name.find(isa) != std::string::npos) {
-                        isa_variant_id = iv.id;
-                        break;
-                    }
+                auto match = isa_matches.find(isa);
+                if (match == isa_matches.end()) {
+                    std::string isa_variant_id = isa_variant_for(isa);
+                    std::string toolchain_id = get_toolchain_for_isa(isa_variant_id);
+                    match = isa_matches.emplace(isa, std::make_pair(isa_variant_id, toolchain_id)).first;
                 }
-                if (isa_variant_id.empty()) isa_variant_id = isa;
+                const auto& [isa_variant_id, toolchain_id] = match->second;
                 for (const auto& bv : metadata_.build_variants) {
                     PresetCombination pc;
                     pc.board = board.id;
                     pc.soc = soc_id;
                     pc.isa_variant = isa_variant_id;
                     pc.build_variant = bv.id;
-                    pc.toolchain_id = get_toolchain_for_isa(isa_variant_id);
+                    pc.toolchain_id = toolchain_id;
                     pc.preset_name = board.id + "_" + soc_id + "_" + isa_variant_id + "_" + bv.id;
                     if (!is_excluded(pc)) result.push_back(pc);
                 }
@@ -59,20 +66,13 @@ std::vector<PresetCombination> PresetGenerator::compute_combinations() {
     return result;
 }
 
-void PresetGenerator::generate(const std::filesystem::path& output_root) {
+void PresetGenerator::generate(const std::filesystem::path& output_root, const ToolchainFiles* toolchain_files) {
     auto combinations = compute_combinations();
     std::filesystem::path source_dir = std::filesystem::absolute(output_root);
     std::string binary_dir_pattern = metadata_.preset_matrix.binary_dir_pattern;
 
-    nlohmann::json data;
-    data["cmake_minimum"] = {
-        {"major", metadata_.project.cmake_minimum.major},
-        {"minor", metadata_.project.cmake_minimum.minor},
-        {"patch", metadata_.project.cmake_minimum.patch}
-    };
-    data["configure_presets"] = nlohmann::json::array();
-    data["build_presets"] = nlohmann::json::array();
-
+    std::vector<ConfiguredPreset> presets;
+    presets.reserve(combinations.size());
     for (const auto& c : combinations) {
         std::string binary_dir = binary_dir_pattern;
         size_t pos = 0;
@@ -81,24 +81,46 @@ void PresetGenerator::generate(const std::filesystem::path& output_root) {
             pos += c.preset_name.size();
         }
 
-        nlohmann::json cfg;
-        cfg["name"] = c.preset_name;
-        cfg["binaryDir"] = source_dir.generic_string() + "/" + binary_dir;
         std::string tc_file = c.toolchain_id;
         if (!metadata_.build_variants.empty()) tc_file += "-" + c.build_variant;
         tc_file += ".cmake";
-        cfg["toolchainFile"] = source_dir.generic_string() + "/toolchains/" + tc_file;
-        cfg["board"] = c.board;
-        cfg["soc"] = c.soc;
-        cfg["isa_variant"] = c.isa_variant;
-        cfg["build_variant"] = c.build_variant;
-        data["configure_presets"].push_back(cfg);
-
-        data["build_presets"].push_back({{"name", c.preset_name}});
+        if (toolchain_files) {
+            auto it = toolchain_files->find({c.toolchain_id, c.build_variant});
+            if (it != toolchain_files->end()) tc_file = it->second;
+        }
+        presets.push_back({&c, source_dir.generic_string() + "/" + binary_dir,
+                           source_dir.generic_string() + "/toolchains/" + tc_file});
     }
 
-    TemplateEngine engine;
-    engine.render_to_file("cmake_presets.jinja2", data, output_root / "CMakePresets.json");
+    const TemplateEngine& engine = TemplateEngine::shared();
+    const CmakeVersion& cmake_minimum = metadata_.project.cmake_minimum;
+    engine.render_to_file(engine.make_job("cmake_presets.jinja2", output_root / "CMakePresets.json",
+        [&](std::string& out) { emit_cmake_presets(out, cmake_minimum, presets); },
+        [&] {
+            nlohmann::json data;
+            data["cmake_minimum"] = {
+                {"major", cmake_minimum.major},
+                {"minor", cmake_minimum.minor},
+                {"patch", cmake_minimum.patch}
+            };
+            data["configure_presets"] = nlohmann::json::array();
+            data["build_presets"] = nlohmann::json::array();
+            for (const auto& p : presets) {
+                const PresetCombination& c = *p.combination;
+                nlohmann::json cfg;
+                cfg["name"] = c.preset_name;
+                cfg["binaryDir"] = p.binary_dir;
+                cfg["toolchainFile"] = p.toolchain_file;
+                cfg["board"] = c.board;
+                cfg["soc"] = c.soc;
+                cfg["isa_variant"] = c.isa_variant;
+                cfg["build_variant"] = c.build_variant;
+                data["configure_presets"].push_back(cfg);
+
+                data["build_presets"].push_back({{"name", c.preset_name}});
+            }
+            return data;
+        }));
 }
 
 }  // namespace scaffolder
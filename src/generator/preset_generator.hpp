@@ -1,7 +1,9 @@
 #pragma once
 
-#include "../metadata/schema.hpp"
+#include "../metadata/metadata_index.hpp"
 #include <filesystem>
+#include <map>
+#include <utility>
 #include <vector>
 #include <string>
 
@@ -16,16 +18,31 @@ struct PresetCombination {
     std::string preset_name;
 };
 
+/** The file below toolchains/ used for each toolchain id and build variant id. */
+using ToolchainFiles = std::map<std::pair<std::string, std::string>, std::string>;
+
+/** A combination with the absolute paths its configure preset points at. */
+struct ConfiguredPreset {
+    const PresetCombination* combination;
+    std::string binary_dir;
+    std::string toolchain_file;
+};
+
 class PresetGenerator {
 public:
-    explicit PresetGenerator(const Metadata& metadata);
-    void generate(const std::filesystem::path& output_root);
+    explicit PresetGenerator(const MetadataIndex& index);
+    /** toolchain_files, if given, names the toolchain file (below toolchains/) of each toolchain id
+     *  and build variant id; otherwise presets use <toolchain>-<build variant>.cmake. */
+    void generate(const std::filesystem::path& output_root, const ToolchainFiles* toolchain_files = nullptr);
+    /** The board x SoC x ISA x build variant combinations that are not excluded. */
+    std::vector<PresetCombination> compute_combinations() const;
 
 private:
-    std::vector<PresetCombination> compute_combinations();
     bool is_excluded(const PresetCombination& c) const;
     std::string get_toolchain_for_isa(const std::string& isa) const;
+    std::string isa_variant_for(const std::string& isa) const;
 
+    const MetadataIndex& index_;
     const Metadata& metadata_;
 };
 
@@ -0,0 +1,60 @@
+#include "generator/render_cache.hpp"
+#include "util/file_write.hpp"
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace scaffolder {
+
+RenderCache::RenderCache(const std::filesystem::path& root) : root_(root) {}
+
+std::filesystem::path RenderCache::entry_path(const std::string& key) const {
+    return root_ / key.substr(0, 2) / key;
+}
+
+std::optional<std::string> RenderCache::find(const std::string& key, const std::string& inputs) const {
+    std::filesystem::path path = entry_path(key);
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return std::nullopt;
+    std::string entry((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (in.bad()) return std::nullopt;
+    // <inputs size>\n<inputs><content>
+    std::string header = std::to_string(inputs.size()) + "\n";
+    if (entry.size() < header.size() + inputs.size() || entry.compare(0, header.size(), header) != 0 ||
+        entry.compare(header.size(), inputs.size(), inputs) != 0) {
+        return std::nullopt;
+    }
+    std::error_code ec;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+    return entry.substr(header.size() + inputs.size());
+}
+
+void RenderCache::store(const std::string& key, const std::string& inputs, const std::string& content) const {
+    write_if_changed(entry_path(key), std::to_string(inputs.size()) + "\n" + inputs + content);
+}
+
+size_t RenderCache::prune(std::chrono::hours max_age) const {
+    size_t removed = 0;
+    std::error_code ec;
+    if (!std::filesystem::is_directory(root_, ec)) return removed;
+    auto now = std::filesystem::file_time_type::clock::now();
+    std::vector<std::filesystem::path> buckets;
+    for (const auto& e : std::filesystem::directory_iterator(root_)) {
+        if (e.is_directory()) buckets.push_back(e.path());
+    }
+    for (const auto& bucket : buckets) {
+        std::vector<std::filesystem::path> entries;
+        for (const auto& e : std::filesystem::directory_iterator(bucket)) entries.push_back(e.path());
+        for (const auto& entry : entries) {
+            auto t = std::filesystem::last_write_time(entry, ec);
+            if (!ec && now - t < max_age) continue;
+            if (std::filesystem::remove(entry, ec)) ++removed;
+        }
+        if (std::filesystem::is_empty(bucket, ec)) std::filesystem::remove(bucket, ec);
+    }
+    return removed;
+}
+
+}  // namespace scaffolder
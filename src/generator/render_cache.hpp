@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+namespace scaffolder {
+
+/** Persistent, content-addressed store of rendered templates shared by the generate runs that
+ *  name it. An entry is the output of one render, stored under a key that hashes the template
+ *  source and the data (<root>/<first two key digits>/<key>), so a render with the same inputs
+ *  anywhere can be replaced by reading the entry. The entry also holds the exact inputs it was
+ *  rendered from, so a key collision is a miss rather than another render's output. Entries are
+ *  written atomically. Thread-safe. */
+class RenderCache {
+public:
+    explicit RenderCache(const std::filesystem::path& root);
+
+    /** The output stored for key, if it was stored with the same inputs; a hit marks the entry as
+     *  used for prune(). */
+    std::optional<std::string> find(const std::string& key, const std::string& inputs) const;
+    void store(const std::string& key, const std::string& inputs, const std::string& content) const;
+
+    /** Removes entries not used for max_age and returns how many. A zero max_age empties the cache. */
+    size_t prune(std::chrono::hours max_age) const;
+
+    const std::filesystem::path& root() const { return root_; }
+
+private:
+    std::filesystem::path entry_path(const std::string& key) const;
+
+    std::filesystem::path root_;
+};
+
+}  // namespace scaffolder
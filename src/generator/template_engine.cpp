@@ -1,33 +1,76 @@
 #include "generator/template_engine.hpp"
-#include "util/executable_path.hpp"
+#include "generator/embedded_templates.hpp"
+#include "generator/render_cache.hpp"
+#include "util/file_write.hpp"
+#include "util/hash.hpp"
+#include "util/run_journal.hpp"
+#include "util/thread_pool.hpp"
 #include <inja/inja.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <fstream>
+#include <mutex>
+#include <optional>
 #include <sstream>
 #include <cstdlib>
+#include <unordered_map>
+#include <utility>
 
 namespace scaffolder {
 
-static std::filesystem::path find_templates_dir() {
-    if (const char* env = std::getenv("CMAKEGEN_TEMPLATES_DIR")) {
-        std::filesystem::path p(env);
-        if (std::filesystem::exists(p)) return p;
-    }
-#ifdef CMAKEGEN_TEMPLATES_DIR
-    {
-        std::filesystem::path p(CMAKEGEN_TEMPLATES_DIR);
-        if (std::filesystem::exists(p)) return p;
-    }
-#endif
-    auto exe_dir = get_executable_directory();
-    if (!exe_dir.empty()) {
-        auto installed = exe_dir / ".." / "share" / "cmakegen" / "templates";
-        if (std::filesystem::exists(installed)) return std::filesystem::canonical(installed);
-    }
-    if (std::filesystem::exists("templates")) return std::filesystem::absolute("templates");
-    return "templates";
+namespace {
+
+std::filesystem::path override_dir_from_env() {
+    const char* env = std::getenv("CMAKEGEN_TEMPLATES_DIR");
+    return env && *env ? std::filesystem::path(env) : std::filesystem::path();
+}
+
+const EmbeddedTemplate* find_embedded(const std::string& name) {
+    const EmbeddedTemplate* end = kEmbeddedTemplates + kEmbeddedTemplateCount;
+    const EmbeddedTemplate* it = std::lower_bound(kEmbeddedTemplates, end, name,
+        [](const EmbeddedTemplate& t, const std::string& n) { return std::strcmp(t.name, n.c_str()) < 0; });
+    return it != end && name == it->name ? it : nullptr;
 }
 
-TemplateEngine::TemplateEngine() : templates_dir_(find_templates_dir()) {}
+// Cache key of a built-in template; files of the override directory never carry it.
+const std::filesystem::file_time_type kEmbeddedMtime = std::filesystem::file_time_type::min();
+
+}  // namespace
+
+// Parsed templates by name, with the mtime of the file they were parsed from. Each parse uses a
+// throwaway environment; renders share env, which they only read. The counters back write_stats().
+struct TemplateEngine::Cache {
+    struct Entry {
+        std::filesystem::file_time_type mtime;
+        std::shared_ptr<const inja::Template> parsed;
+        std::string source_hash;  // keys the render cache
+    };
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    inja::Environment env;
+    std::shared_ptr<const RenderCache> renders;
+    std::atomic<size_t> created{0};
+    std::atomic<size_t> changed{0};
+    std::atomic<size_t> unchanged{0};
+    std::atomic<size_t> cached{0};
+
+    /** The parsed template, loading and parsing it unless the cached parse is still current. */
+    Entry get(const TemplateEngine& engine, const std::string& name);
+};
+
+TemplateEngine::TemplateEngine() : TemplateEngine(override_dir_from_env()) {}
+
+TemplateEngine::TemplateEngine(const std::filesystem::path& templates_dir)
+    : templates_dir_(templates_dir), cache_(std::make_unique<Cache>()) {}
+
+TemplateEngine::~TemplateEngine() = default;
+
+TemplateEngine& TemplateEngine::shared() {
+    static TemplateEngine engine;
+    return engine;
+}
 
 std::string TemplateEngine::load_template(const std::string& name) const {
     std::filesystem::path p = templates_dir_ / name;
@@ -40,21 +83,141 @@ std::string TemplateEngine::load_template(const std::string& name) const {
     return ss.str();
 }
 
+TemplateEngine::Cache::Entry TemplateEngine::Cache::get(const TemplateEngine& engine, const std::string& name) {
+    // A file in the override directory wins; otherwise the built-in template, without touching the disk.
+    std::error_code ec;
+    auto mtime = kEmbeddedMtime;
+    bool from_file = false;
+    if (!engine.templates_dir_.empty()) {
+        mtime = std::filesystem::last_write_time(engine.templates_dir_ / name, ec);
+        from_file = !ec;
+    }
+    const EmbeddedTemplate* builtin = from_file ? nullptr : find_embedded(name);
+    if (!from_file && !builtin) throw std::runtime_error("Cannot load template: " + name);
+    if (!from_file) mtime = kEmbeddedMtime;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(name);
+        if (it != entries.end() && it->second.mtime == mtime) return it->second;
+    }
+    std::string source = from_file ? engine.load_template(name)
+                                   : std::string(reinterpret_cast<const char*>(builtin->data), builtin->size);
+    Entry entry{mtime, nullptr, Fnv1a().field(name).field(source).hex()};
+    try {
+        entry.parsed = std::make_shared<const inja::Template>(inja::Environment().parse(source));
+    } catch (const std::exception& e) {
+        throw std::runtime_error(std::string("Template '") + name + "': " + e.what());
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[name] = entry;
+    return entry;
+}
+
 std::string TemplateEngine::render(const std::string& template_name, const nlohmann::json& data) const {
-    std::string tmpl = load_template(template_name);
+    Cache::Entry entry = cache_->get(*this, template_name);
     try {
-        return inja::render(tmpl, data);
+        return cache_->env.render(*entry.parsed, data);
     } catch (const std::exception& e) {
         throw std::runtime_error(std::string("Template '") + template_name + "': " + e.what());
     }
 }
 
+std::string TemplateEngine::fingerprint() const {
+    Fnv1a hash;
+    for (size_t i = 0; i < kEmbeddedTemplateCount; ++i) {
+        const EmbeddedTemplate& t = kEmbeddedTemplates[i];
+        hash.field(t.name).field(std::string_view(reinterpret_cast<const char*>(t.data), t.size));
+    }
+    if (!templates_dir_.empty()) hash.field(fingerprint_tree(templates_dir_));
+    return hash.hex();
+}
+
 void TemplateEngine::render_to_file(const std::string& template_name, const nlohmann::json& data,
                                     const std::filesystem::path& output_path) const {
-    std::string result = render(template_name, data);
-    std::filesystem::create_directories(output_path.parent_path());
-    std::ofstream f(output_path);
-    f << result;
+    if (!cache_->renders) {
+        write_output(output_path, render(template_name, data));
+        return;
+    }
+    // CBOR, unlike dump(), takes any string bytes; objects are sorted by key, so equal data encodes equally.
+    // The entry keeps these inputs and find() compares them, so the 64-bit key only locates an entry.
+    std::vector<uint8_t> cbor = nlohmann::json::to_cbor(data);
+    std::string inputs = cache_->get(*this, template_name).source_hash + '\n';
+    inputs.append(reinterpret_cast<const char*>(cbor.data()), cbor.size());
+    std::string key = Fnv1a().field(inputs).hex();
+    if (std::optional<std::string> hit = cache_->renders->find(key, inputs)) {
+        ++cache_->cached;
+        write_output(output_path, *hit);
+        return;
+    }
+    std::string content = render(template_name, data);
+    cache_->renders->store(key, inputs, content);
+    write_output(output_path, content);
+}
+
+void TemplateEngine::render_to_file(const RenderJob& job) const {
+    if (!job.emit) {
+        render_to_file(job.template_name, job.data, job.output_path);
+        return;
+    }
+    std::string content;
+    job.emit(content);
+    write_output(job.output_path, content);
+}
+
+void TemplateEngine::write_output(const std::filesystem::path& output_path, const std::string& content) const {
+    // Rewriting an identical file would still bump its mtime and make CMake reconfigure.
+    switch (write_if_changed(output_path, content)) {
+        case WriteResult::Created: ++cache_->created; break;
+        case WriteResult::Changed: ++cache_->changed; break;
+        case WriteResult::Unchanged: ++cache_->unchanged; break;
+    }
+}
+
+RenderJob TemplateEngine::make_job(const std::string& template_name, const std::filesystem::path& output_path,
+                                   std::function<void(std::string&)> emit,
+                                   const std::function<nlohmann::json()>& make_data) const {
+    if (has_override(template_name)) return {template_name, make_data(), output_path, nullptr};
+    return {template_name, nullptr, output_path, std::move(emit)};
+}
+
+bool TemplateEngine::has_override(const std::string& template_name) const {
+    std::error_code ec;
+    return !templates_dir_.empty() && std::filesystem::is_regular_file(templates_dir_ / template_name, ec);
+}
+
+WriteStats TemplateEngine::write_stats() const {
+    return {cache_->created.load(), cache_->changed.load(), cache_->unchanged.load(), cache_->cached.load()};
+}
+
+void TemplateEngine::set_render_cache(std::shared_ptr<const RenderCache> renders) {
+    cache_->renders = std::move(renders);
+}
+
+void TemplateEngine::render_all(const std::vector<RenderJob>& jobs, unsigned workers) const {
+    workers = std::min<unsigned>(ThreadPool::resolve_jobs(workers), static_cast<unsigned>(jobs.size()));
+    if (workers <= 1) {
+        for (const auto& job : jobs) render_to_file(job);
+        return;
+    }
+    // Errors are kept per job rather than left to the pool, which would report whichever failed first in time.
+    std::vector<std::exception_ptr> errors(jobs.size());
+    {
+        ThreadPool pool(workers);
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            pool.submit([this, &jobs, &errors, i] {
+                try {
+                    render_to_file(jobs[i]);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            });
+        }
+        pool.wait();
+    }
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
 }
 
 }  // namespace scaffolder
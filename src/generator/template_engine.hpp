@@ -2,20 +2,82 @@
 
 #include <nlohmann/json.hpp>
 #include <filesystem>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace scaffolder {
 
+class RenderCache;
+
+/** One file to render: template, data and the path the result is written to. When emit is set it
+ *  produces the file instead (see native_emitters.hpp) and data is unused. */
+struct RenderJob {
+    std::string template_name;
+    nlohmann::json data;
+    std::filesystem::path output_path;
+    std::function<void(std::string&)> emit;
+};
+
+/** What render_to_file did with its output files. */
+struct WriteStats {
+    size_t created = 0;
+    size_t changed = 0;
+    size_t unchanged = 0;  // same bytes already present; left untouched
+    size_t cached = 0;     // taken from the render cache instead of rendered (any of the above)
+};
+
+/** Renders templates. The built-in templates are compiled into the executable (see
+ *  embedded_templates.hpp); a file of the same name in the override directory replaces one.
+ *  Each template is parsed once and reused until its file's mtime changes. Generators use
+ *  shared(), so every template is parsed once per process. Thread-safe. */
 class TemplateEngine {
 public:
+    /** Overrides from $CMAKEGEN_TEMPLATES_DIR, if set. */
     TemplateEngine();
+    /** Overrides from templates_dir; an empty path uses the built-in templates only. */
+    explicit TemplateEngine(const std::filesystem::path& templates_dir);
+    ~TemplateEngine();
+    TemplateEngine(const TemplateEngine&) = delete;
+    TemplateEngine& operator=(const TemplateEngine&) = delete;
+
+    /** Process-wide default-constructed engine. */
+    static TemplateEngine& shared();
+
     std::string render(const std::string& template_name, const nlohmann::json& data) const;
+    /** Renders into output_path, replacing the file atomically and only if its content differs. */
     void render_to_file(const std::string& template_name, const nlohmann::json& data,
                         const std::filesystem::path& output_path) const;
+    /** A job for template_name: native through emit unless the override directory replaces the
+     *  template, in which case make_data builds the template's data. */
+    RenderJob make_job(const std::string& template_name, const std::filesystem::path& output_path,
+                       std::function<void(std::string&)> emit,
+                       const std::function<nlohmann::json()>& make_data) const;
+    void render_to_file(const RenderJob& job) const;
+    /** Renders and writes every job on up to workers threads (0 = one per hardware thread). Each job
+     *  owns a distinct output path, so the files are identical to rendering the jobs one by one.
+     *  If jobs fail, the error of the first failing job in list order is thrown once all finished. */
+    void render_all(const std::vector<RenderJob>& jobs, unsigned workers = 1) const;
+    /** Override directory; empty when only the built-in templates are used. */
+    const std::filesystem::path& templates_dir() const { return templates_dir_; }
+    /** Whether the override directory has a file for template_name. */
+    bool has_override(const std::string& template_name) const;
+    /** Makes render_to_file look inja renders up in renders, keyed by the template source and the
+     *  data, and store them there. Null disables it. Set before rendering, not concurrently. */
+    void set_render_cache(std::shared_ptr<const RenderCache> renders);
+    /** Totals over every render_to_file of this engine. */
+    WriteStats write_stats() const;
+    /** Hash of the built-in templates and of the override directory's files. */
+    std::string fingerprint() const;
 
 private:
+    struct Cache;
+
     std::filesystem::path templates_dir_;
+    std::unique_ptr<Cache> cache_;
     std::string load_template(const std::string& name) const;
+    void write_output(const std::filesystem::path& output_path, const std::string& content) const;
 };
 
 }  // namespace scaffolder
@@ -1,11 +1,43 @@
 #include "generator/toolchain_generator.hpp"
+#include "generator/native_emitters.hpp"
 #include "generator/template_engine.hpp"
 #include <nlohmann/json.hpp>
 #include <algorithm>
+#include <set>
+#include <utility>
 
 namespace scaffolder {
 
-ToolchainGenerator::ToolchainGenerator(const Metadata& metadata) : metadata_(metadata) {}
+namespace {
+
+const char* const kFlagTypes[] = {"c", "cxx", "asm", "linker"};
+
+const std::vector<std::string>* find_flags(const std::map<std::string, std::vector<std::string>>& flags,
+                                           const std::string& flag_type) {
+    auto it = flags.find(flag_type);
+    return it != flags.end() ? &it->second : nullptr;
+}
+
+void append(std::vector<std::string>& to, const std::vector<std::string>* flags) {
+    if (flags) to.insert(to.end(), flags->begin(), flags->end());
+}
+
+}  // namespace
+
+ToolchainGenerator::ToolchainGenerator(const MetadataIndex& index) : index_(index), metadata_(index.metadata()) {
+    // Inherited variants come first in build_variant_order(), so each variant extends its parent's
+    // flattened flags. In an inheritance cycle (rejected by the validator) a variant only extends
+    // the members flattened before it.
+    for (const BuildVariant* bv : index.graph().build_variant_order()) {
+        FlatVariant flat;
+        if (bv->inherits) {
+            auto parent = flat_variants_.find(index.build_variant(*bv->inherits));
+            if (parent != flat_variants_.end()) flat = parent->second;
+        }
+        apply_variant(flat, *bv);
+        flat_variants_.emplace(bv, std::move(flat));
+    }
+}
 
 static std::string infer_processor(const Toolchain& tc) {
     std::string c = tc.compiler.c;
@@ -15,81 +47,171 @@ static std::string infer_processor(const Toolchain& tc) {
     return "generic";
 }
 
+void ToolchainGenerator::apply_variant(FlatVariant& flat, const BuildVariant& bv) {
+    // (base - R1) + A1, then (.. - R2) + A2, is (base - (R1 + R2)) + (A1 - R2) + A2: removals also
+    // strip the flags the inherited variants added.
+    for (const std::string flag_type : kFlagTypes) {
+        const auto* remove = find_flags(bv.remove_flags, flag_type);
+        if (!remove || remove->empty()) continue;
+        auto& removed = flat.removed[flag_type];
+        removed.insert(remove->begin(), remove->end());
+        const std::unordered_set<std::string> own(remove->begin(), remove->end());
+        auto strip = [&](FlagsByType& added) {
+            auto it = added.find(flag_type);
+            if (it == added.end()) return;
+            auto& flags = it->second;
+            flags.erase(std::remove_if(flags.begin(), flags.end(), [&](const std::string& f) { return own.count(f) > 0; }),
+                        flags.end());
+        };
+        strip(flat.added);
+        for (auto& [tc_id, added] : flat.added_for) strip(added);
+    }
+    // Toolchains this variant names start from what the chain added for every toolchain.
+    for (const auto& [tc_id, flags] : bv.add_flags) flat.added_for.emplace(tc_id, flat.added);
+
+    for (const std::string flag_type : kFlagTypes) {
+        const auto* defaults = find_flags(bv.flags, flag_type);
+        append(flat.added[flag_type], defaults);
+        for (auto& [tc_id, added] : flat.added_for) {
+            const std::vector<std::string>* own = nullptr;
+            auto it_tc = bv.add_flags.find(tc_id);
+            if (it_tc != bv.add_flags.end()) own = find_flags(it_tc->second, flag_type);
+            append(added[flag_type], own && !own->empty() ? own : defaults);
+        }
+    }
+}
+
 std::vector<std::string> ToolchainGenerator::merge_flags(const std::vector<std::string>& base,
-                                                         const BuildVariant* bv,
+                                                         const FlatVariant* flat,
                                                          const std::string& tc_id,
                                                          const std::string& flag_type) const {
-    std::vector<std::string> result = base;
-
-    if (bv) {
-        auto it_remove = bv->remove_flags.find(flag_type);
-        if (it_remove != bv->remove_flags.end()) {
-            for (const auto& to_remove : it_remove->second) {
-                result.erase(std::remove(result.begin(), result.end(), to_remove), result.end());
-            }
+    if (!flat) return base;
+
+    std::vector<std::string> result;
+    auto it_removed = flat->removed.find(flag_type);
+    if (it_removed == flat->removed.end()) {
+        result = base;
+    } else {
+        for (const auto& f : base) {
+            if (!it_removed->second.count(f)) result.push_back(f);
         }
-
-        std::vector<std::string> to_add;
-        auto it_tc = bv->add_flags.find(tc_id);
-        if (it_tc != bv->add_flags.end()) {
-            auto it_type = it_tc->second.find(flag_type);
-            if (it_type != it_tc->second.end()) to_add = it_type->second;
-        }
-        if (to_add.empty()) {
-            auto it_def = bv->flags.find(flag_type);
-            if (it_def != bv->flags.end()) to_add = it_def->second;
-        }
-        for (const auto& f : to_add) result.push_back(f);
     }
-
+    auto it_tc = flat->added_for.find(tc_id);
+    append(result, find_flags(it_tc != flat->added_for.end() ? it_tc->second : flat->added, flag_type));
     return result;
 }
 
-void ToolchainGenerator::generate_toolchain(const Toolchain& tc, const BuildVariant* bv,
-                                            const std::filesystem::path& output_dir) {
-    nlohmann::json data;
-    data["display_name"] = tc.display_name;
-    data["processor"] = infer_processor(tc);
-    data["compiler"] = {{"c", tc.compiler.c}, {"cxx", tc.compiler.cxx}, {"asm", tc.compiler.asm_}};
-
-    data["flags"] = nlohmann::json::object();
-    for (const std::string& flag_type : {"c", "cxx", "asm", "linker"}) {
-        std::vector<std::string> base_vec;
-        auto it = tc.flags.find(flag_type);
-        if (it != tc.flags.end()) base_vec = it->second;
-        std::vector<std::string> merged = merge_flags(base_vec, bv, tc.id, flag_type);
-        if (!merged.empty()) data["flags"][flag_type] = merged;
+ToolchainGenerator::FlagsByType ToolchainGenerator::merged_flags(const Toolchain& tc, const BuildVariant* bv) const {
+    const FlatVariant* flat = nullptr;
+    if (bv) {
+        auto it = flat_variants_.find(bv);
+        if (it != flat_variants_.end()) flat = &it->second;
     }
+    FlagsByType result;
+    for (const std::string flag_type : kFlagTypes) {
+        const auto* base = find_flags(tc.flags, flag_type);
+        result[flag_type] = merge_flags(base ? *base : std::vector<std::string>{}, flat, tc.id, flag_type);
+    }
+    return result;
+}
 
-    data["sysroot"] = tc.sysroot;
-    data["defines"] = tc.defines;
-    data["lib_paths"] = tc.lib_paths;
-    data["libs"] = tc.libs;
-
-    std::string filename = tc.id;
+std::string ToolchainGenerator::file_name(const std::string& tc_id, const BuildVariant* bv) {
+    std::string filename = tc_id;
     if (bv) filename += "-" + bv->id;
-    filename += ".cmake";
+    return filename + ".cmake";
+}
 
-    TemplateEngine engine;
-    engine.render_to_file("toolchain.jinja2", data, output_dir / filename);
+RenderJob ToolchainGenerator::toolchain_job(const Toolchain& tc, const BuildVariant* bv,
+                                            const std::filesystem::path& output_path) const {
+    return TemplateEngine::shared().make_job("toolchain.jinja2", output_path,
+        [this, &tc, bv](std::string& out) { emit_toolchain(out, tc, infer_processor(tc), merged_flags(tc, bv)); },
+        [&] {
+            nlohmann::json data;
+            data["display_name"] = tc.display_name;
+            data["processor"] = infer_processor(tc);
+            data["compiler"] = {{"c", tc.compiler.c}, {"cxx", tc.compiler.cxx}, {"asm", tc.compiler.asm_}};
+            // Every flag type is present, possibly empty, so the template can test each one.
+            data["flags"] = merged_flags(tc, bv);
+            data["sysroot"] = tc.sysroot;
+            data["defines"] = tc.defines;
+            data["lib_paths"] = tc.lib_paths;
+            data["libs"] = tc.libs;
+            return data;
+        });
 }
 
-void ToolchainGenerator::generate_all(const std::filesystem::path& output_root) {
+void ToolchainGenerator::generate_all(const std::filesystem::path& output_root, unsigned jobs) {
     std::filesystem::path toolchains_dir = output_root / "toolchains";
     std::filesystem::create_directories(toolchains_dir);
 
+    std::vector<RenderJob> render_jobs;
     if (metadata_.build_variants.empty()) {
         for (const auto& tc : metadata_.toolchains) {
-            generate_toolchain(tc, nullptr, toolchains_dir);
+            render_jobs.push_back(toolchain_job(tc, nullptr, toolchains_dir / file_name(tc.id, nullptr)));
         }
-        return;
+    } else {
+        render_jobs.reserve(metadata_.toolchains.size() * metadata_.build_variants.size());
+        for (const auto& tc : metadata_.toolchains) {
+            for (const auto& bv : metadata_.build_variants) {
+                render_jobs.push_back(toolchain_job(tc, &bv, toolchains_dir / file_name(tc.id, &bv)));
+            }
+        }
+    }
+    TemplateEngine::shared().render_all(render_jobs, jobs);
+}
+
+std::vector<std::string> ToolchainGenerator::all_files() const {
+    std::vector<std::string> files;
+    for (const auto& tc : metadata_.toolchains) {
+        if (metadata_.build_variants.empty()) files.push_back(file_name(tc.id, nullptr));
+        for (const auto& bv : metadata_.build_variants) files.push_back(file_name(tc.id, &bv));
     }
+    return files;
+}
+
+ToolchainFiles ToolchainGenerator::referenced_files(const std::vector<PresetCombination>& combinations) const {
+    std::set<std::pair<std::string, std::string>> referenced;
+    for (const auto& c : combinations) referenced.emplace(c.toolchain_id, c.build_variant);
 
+    // A toolchain file is rendered from exactly these inputs, so equal keys mean equal contents
+    // whichever template renders them; the toolchain id itself does not appear in the file. Lists
+    // are prefixed with their sizes, so no two different inputs serialize to the same key.
+    ToolchainFiles files;
+    std::map<std::vector<std::string>, std::string> file_by_content;
     for (const auto& tc : metadata_.toolchains) {
         for (const auto& bv : metadata_.build_variants) {
-            generate_toolchain(tc, &bv, toolchains_dir);
+            std::pair<std::string, std::string> id(tc.id, bv.id);
+            if (!referenced.count(id) || files.count(id) || index_.toolchain(tc.id) != &tc) continue;
+            std::vector<std::string> key = {tc.display_name, infer_processor(tc), tc.compiler.c,
+                                            tc.compiler.cxx, tc.compiler.asm_, tc.sysroot};
+            FlagsByType flags_by_type = merged_flags(tc, &bv);
+            key.push_back(std::to_string(flags_by_type.size()));
+            for (const auto& [flag_type, flags] : flags_by_type) {
+                key.push_back(flag_type);
+                key.push_back(std::to_string(flags.size()));
+                key.insert(key.end(), flags.begin(), flags.end());
+            }
+            for (const auto* list : {&tc.defines, &tc.lib_paths, &tc.libs}) {
+                key.push_back(std::to_string(list->size()));
+                key.insert(key.end(), list->begin(), list->end());
+            }
+            files[id] = file_by_content.emplace(std::move(key), file_name(tc.id, &bv)).first->second;
         }
     }
+    return files;
+}
+
+void ToolchainGenerator::generate(const std::filesystem::path& output_root, const ToolchainFiles& files, unsigned jobs) {
+    std::filesystem::path toolchains_dir = output_root / "toolchains";
+    std::filesystem::create_directories(toolchains_dir);
+
+    std::vector<RenderJob> render_jobs;
+    for (const auto& [id, file] : files) {
+        const Toolchain* tc = index_.toolchain(id.first);
+        const BuildVariant* bv = index_.build_variant(id.second);
+        if (tc && bv && file == file_name(tc->id, bv)) render_jobs.push_back(toolchain_job(*tc, bv, toolchains_dir / file));
+    }
+    TemplateEngine::shared().render_all(render_jobs, jobs);
 }
 
 }  // namespace scaffolder
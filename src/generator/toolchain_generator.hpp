@@ -1,23 +1,62 @@
 #pragma once
 
-#include "../metadata/schema.hpp"
+#include "../metadata/metadata_index.hpp"
+#include "preset_generator.hpp"
+#include "template_engine.hpp"
 #include <filesystem>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace scaffolder {
 
 class ToolchainGenerator {
 public:
-    explicit ToolchainGenerator(const Metadata& metadata);
-    void generate_all(const std::filesystem::path& output_root);
+    explicit ToolchainGenerator(const MetadataIndex& index);
+    /** One file per toolchain and build variant, rendered on up to jobs workers (0 = one per
+     *  hardware thread); the output does not depend on jobs. */
+    void generate_all(const std::filesystem::path& output_root, unsigned jobs = 1);
+
+    /** Names of the files generate_all writes. */
+    std::vector<std::string> all_files() const;
+
+    /** The files the combinations need: one per distinct toolchain file content, named after the
+     *  first toolchain and build variant (in metadata order) that produces it. Combinations whose
+     *  toolchain does not exist are left out. */
+    ToolchainFiles referenced_files(const std::vector<PresetCombination>& combinations) const;
+    /** Writes each file of files once, like generate_all. */
+    void generate(const std::filesystem::path& output_root, const ToolchainFiles& files, unsigned jobs = 1);
+
+    /** <toolchain id>[-<build variant id>].cmake */
+    static std::string file_name(const std::string& tc_id, const BuildVariant* bv);
 
 private:
-    void generate_toolchain(const Toolchain& tc, const BuildVariant* bv,
-                            const std::filesystem::path& output_dir);
+    using FlagsByType = std::map<std::string, std::vector<std::string>>;
+
+    /** A build variant with its inheritance chain applied: the toolchain base flags minus removed,
+     *  followed by added_for[toolchain id], or added for toolchains it does not name. */
+    struct FlatVariant {
+        std::map<std::string, std::unordered_set<std::string>> removed;
+        FlagsByType added;
+        std::map<std::string, FlagsByType> added_for;
+    };
+
+    /** Applies bv's own flags on top of flat, which holds the variant it inherits (or nothing). */
+    static void apply_variant(FlatVariant& flat, const BuildVariant& bv);
+
+    RenderJob toolchain_job(const Toolchain& tc, const BuildVariant* bv,
+                            const std::filesystem::path& output_path) const;
+    /** merge_flags for each flag type (c, cxx, asm, linker). */
+    FlagsByType merged_flags(const Toolchain& tc, const BuildVariant* bv) const;
     std::vector<std::string> merge_flags(const std::vector<std::string>& base,
-                                         const BuildVariant* bv, const std::string& tc_id,
+                                         const FlatVariant* flat, const std::string& tc_id,
                                          const std::string& flag_type) const;
 
+    const MetadataIndex& index_;
     const Metadata& metadata_;
+    std::unordered_map<const BuildVariant*, FlatVariant> flat_variants_;  // flattened once, shared by all toolchains
 };
 
 }  // namespace scaffolder
@@ -1,17 +1,28 @@
 #include "config/config_loader.hpp"
-#include "config/resolver.hpp"
+#include "config/config_writer.hpp"
 #include "metadata/validator.hpp"
 #include "resolver/path_resolver.hpp"
-#include "resolver/git_cloner.hpp"
+#include "resolver/git_cache.hpp"
 #include "copy/copy_engine.hpp"
 #include "generator/cmake_generator.hpp"
 #include "generator/toolchain_generator.hpp"
 #include "generator/preset_generator.hpp"
 #include "generator/conan_generator.hpp"
+#include "generator/template_engine.hpp"
+#include "generator/render_cache.hpp"
 #include "interactive/add_runner.hpp"
+#include "util/hash.hpp"
+#include "util/run_journal.hpp"
 #include <CLI/CLI.hpp>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <chrono>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <filesystem>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -36,9 +47,83 @@ int main(int argc, char* argv[]) {
         ->required();
     gen_cmd->add_option("-o,--output", output_dir, "Output directory for scaffolded project")
         ->default_val("./output");
+    scaffolder::CopyOptions copy_options;
+    gen_cmd->add_option("-j,--jobs", copy_options.jobs, "Parallel validation, copy and render workers (0 = one per hardware thread)")
+        ->default_val(1);
+    gen_cmd->add_flag("--incremental", copy_options.incremental,
+        "Skip source files whose copy is up to date; copied files keep the source mtime");
+    std::string compare_mode = "mtime";
+    gen_cmd->add_option("--compare", compare_mode, "Up-to-date check for --incremental: mtime (size+mtime) or content")
+        ->check(CLI::IsMember({"mtime", "content"}))
+        ->default_val("mtime");
+    std::string materialize_mode = "copy";
+    gen_cmd->add_option("--materialize", materialize_mode,
+            "How sources appear in the output: copy, hardlink, reflink or symlink (falls back to copy per file)")
+        ->check(CLI::IsMember({"copy", "hardlink", "reflink", "symlink"}))
+        ->default_val("copy");
+    std::string copy_backend = "portable";
+    gen_cmd->add_option("--copy-backend", copy_backend,
+            "Byte copy backend: portable, copy_file_range or io_uring (Linux; falls back to portable)")
+        ->check(CLI::IsMember({"portable", "copy_file_range", "io_uring"}))
+        ->default_val("portable");
+    bool dry_run = false;
+    gen_cmd->add_flag("--dry-run", dry_run, "Plan the source copy and print what it would do; write nothing");
+    std::string plan_out;
+    gen_cmd->add_option("--plan-out", plan_out, "Write the copy plan (source, destination, size, reason per file) as JSON");
+    bool resume = false;
+    gen_cmd->add_flag("--resume", resume,
+        "Continue an interrupted run: skip component copies and renders the output journal records as done and still valid");
+
+    std::string git_cache_dir;
+    gen_cmd->add_option("--git-cache", git_cache_dir,
+        "Persistent git mirror cache (default: $CMAKEGEN_GIT_CACHE or ~/.cache/cmakegen/git)");
+    unsigned git_jobs = 4;
+    gen_cmd->add_option("--git-jobs", git_jobs, "Git clones/fetches run at once (0 = one per hardware thread)")
+        ->default_val(4);
+    bool git_refresh = false;
+    gen_cmd->add_flag("--git-refresh", git_refresh,
+        "Fetch branch refs (including the default main) even when the git cache already has them");
+    bool git_direct = false;
+    gen_cmd->add_flag("--git-direct", git_direct,
+        "Write git components' selected files once into the output, without a cached worktree, and move them into place");
+    std::string toolchain_files_mode = "all";
+    gen_cmd->add_option("--toolchain-files", toolchain_files_mode,
+            "all: one toolchain file per toolchain and build variant; referenced: only those presets use, one per distinct content")
+        ->check(CLI::IsMember({"all", "referenced"}))
+        ->default_val("all");
+    std::string render_cache_dir;
+    gen_cmd->add_option("--render-cache", render_cache_dir,
+        "Reuse inja template renders from this persistent cache directory (off unless given)");
+
+    auto* cache_cmd = app.add_subcommand("cache", "Manage the persistent git mirror and render caches.");
+    auto* prune_cmd = cache_cmd->add_subcommand("prune", "Remove cached worktrees, mirrors and renders not used recently.");
+    cache_cmd->require_subcommand(1);
+    prune_cmd->add_option("--git-cache", git_cache_dir, "Git cache directory (default: as for generate)");
+    prune_cmd->add_option("--render-cache", render_cache_dir, "Render cache directory to prune as well");
+    unsigned prune_days = 30;
+    prune_cmd->add_option("--max-age", prune_days, "Keep entries used within this many days (0 = remove everything)")
+        ->default_val(30);
 
     CLI11_PARSE(app, argc, argv);
 
+    if (prune_cmd->parsed()) {
+        try {
+            scaffolder::GitCache git_cache(git_cache_dir.empty() ? scaffolder::GitCache::default_root() : fs::path(git_cache_dir));
+            scaffolder::GitCache::PruneStats stats = git_cache.prune(std::chrono::hours(24) * prune_days);
+            std::cout << "Pruned " << stats.worktrees << " worktrees and " << stats.mirrors << " mirrors from "
+                      << git_cache.root().string() << "\n";
+            if (!render_cache_dir.empty()) {
+                scaffolder::RenderCache render_cache(render_cache_dir);
+                size_t renders = render_cache.prune(std::chrono::hours(24) * prune_days);
+                std::cout << "Pruned " << renders << " cached renders from " << render_cache.root().string() << "\n";
+            }
+            return 0;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
     if (add_cmd->parsed()) {
         fs::path folder = metadata_folder;
         std::filesystem::create_directories(folder);
@@ -71,53 +156,167 @@ int main(int argc, char* argv[]) {
             scaffolder::ConfigLoader loader;
             scaffolder::Metadata metadata = loader.load(meta_path);
 
+            // Built once; the validator and every generator look ids up through it.
+            const scaffolder::MetadataIndex index(metadata);
             scaffolder::Validator validator;
-            validator.validate(metadata);
-
-            scaffolder::resolve(metadata);
+            validator.validate(index, copy_options.jobs);
 
             fs::path output_path(output_dir);
-            fs::create_directories(output_path);
+            // A dry run leaves the output directory as it is, including whether it exists.
+            if (!dry_run) fs::create_directories(output_path);
             fs::path base_dir = meta_path.is_absolute() ? meta_path : fs::absolute(meta_path);
 
             scaffolder::PathResolver path_resolver(base_dir);
 
-            fs::path cache_dir = output_path / ".cmakegen_cache";
-            scaffolder::GitCloner git_cloner(cache_dir);
+            // Completed work is journaled as it finishes so that --resume can skip it.
+            scaffolder::RunJournal journal(output_path, resume, !dry_run);
+
+            scaffolder::GitCache git_cache(git_cache_dir.empty() ? scaffolder::GitCache::default_root() : fs::path(git_cache_dir),
+                                           git_refresh);
+            // --git-direct: git sources are staged next to their destinations (same filesystem, so the
+            // copy stage renames them) and the staging area is removed once the copy is done.
+            fs::path staging = output_path / ".cmakegen_staging";
+            if (!dry_run) fs::remove_all(staging);
+            std::vector<scaffolder::GitCache::CheckoutRequest> checkouts;
+            std::vector<std::string> not_cached;
             for (const auto& comp : metadata.source_tree.components) {
                 if (comp.git && comp.git->url.size() > 0) {
-                    fs::path cloned = git_cloner.clone(*comp.git, comp.id);
-                    path_resolver.set_resolved_source(comp.id, cloned);
+                    std::vector<std::string> sparse = scaffolder::sparse_checkout_patterns(comp);
+                    if (git_direct) copy_options.staged.insert(comp.id);
+                    if (dry_run) {
+                        // No fetch and no staging: plan from the worktree a previous run left in the cache.
+                        fs::path worktree = git_cache.cached_checkout(*comp.git, sparse);
+                        if (worktree.empty()) not_cached.push_back(comp.id);
+                        else path_resolver.set_resolved_source(comp.id, worktree);
+                        continue;
+                    }
+                    checkouts.push_back({comp.id, *comp.git, std::move(sparse), git_direct ? staging : fs::path()});
                 }
             }
-
-            scaffolder::CopyEngine copy_engine(path_resolver, output_path);
-            for (const auto& comp : metadata.source_tree.components) {
-                copy_engine.copy_component(comp);
+            std::vector<fs::path> worktrees = git_cache.checkout_all(checkouts, git_jobs);
+            for (size_t i = 0; i < checkouts.size(); ++i) {
+                path_resolver.set_resolved_source(checkouts[i].component_id, worktrees[i]);
             }
 
-            scaffolder::CmakeGenerator cmake_gen(metadata, path_resolver, output_path);
-            scaffolder::ToolchainGenerator toolchain_gen(metadata);
-            scaffolder::PresetGenerator preset_gen(metadata);
-            scaffolder::ConanGenerator conan_gen(metadata);
+            if (compare_mode == "content") copy_options.compare = scaffolder::CompareMode::Content;
+            if (materialize_mode == "hardlink") copy_options.materialize = scaffolder::Materialize::Hardlink;
+            else if (materialize_mode == "reflink") copy_options.materialize = scaffolder::Materialize::Reflink;
+            else if (materialize_mode == "symlink") copy_options.materialize = scaffolder::Materialize::Symlink;
+            if (copy_backend == "copy_file_range") copy_options.backend = scaffolder::CopyBackendKind::CopyFileRange;
+            else if (copy_backend == "io_uring") copy_options.backend = scaffolder::CopyBackendKind::IoUring;
+            scaffolder::CopyEngine copy_engine(path_resolver, output_path, copy_options);
+            scaffolder::CopyPlan copy_plan = copy_engine.plan(metadata.source_tree.components);
+            std::map<std::string, std::string> copy_keys;  // component id -> copy fingerprint
+            size_t roots = copy_plan.roots().size();
+            for (uint32_t r = 0; r < roots; ++r) {
+                copy_keys[copy_plan.roots()[r].component] =
+                    scaffolder::Fnv1a().field(copy_plan.fingerprint(r)).field(materialize_mode).hex();
+            }
+            size_t resumed = 0;
+            for (uint32_t r = 0; r < roots; ++r) {
+                const std::string& id = copy_plan.roots()[r].component;
+                if (resume && journal.is_done("copy", id, copy_keys[id]) && copy_plan.outputs_present(r)) {
+                    copy_plan.drop_root(r);
+                    ++resumed;
+                }
+            }
+            if (resume) std::cout << "Resuming: " << resumed << " of " << roots << " component copies already done\n";
+            if (!plan_out.empty()) {
+                fs::path plan_path(plan_out);
+                if (plan_path.has_parent_path()) fs::create_directories(plan_path.parent_path());
+                std::ofstream out(plan_path);
+                if (!out) throw std::runtime_error("cannot write plan: " + plan_out);
+                copy_plan.write_json(out);
+            }
+            if (dry_run) {
+                scaffolder::CopyPlan::Summary summary = copy_plan.summary();
+                std::cout << "Dry run: would write " << summary.files << " files (" << summary.bytes << " bytes), "
+                          << summary.unchanged << " unchanged\n";
+                if (!not_cached.empty()) {
+                    std::cout << "Not planned (git source not in the cache; run once to fetch it):";
+                    for (const auto& id : not_cached) std::cout << " " << id;
+                    std::cout << "\n";
+                }
+                return 0;
+            }
+            copy_engine.execute(copy_plan, [&](uint32_t root) {
+                const std::string& id = copy_plan.roots()[root].component;
+                journal.mark_done("copy", id, copy_keys.at(id));
+            });
+            fs::remove_all(staging);
+            if (copy_options.incremental || copy_options.materialize != scaffolder::Materialize::Copy || git_direct) {
+                scaffolder::CopyStats stats = copy_engine.stats();
+                std::cout << "Copied " << stats.copied << " files, linked " << stats.linked << ", moved "
+                          << stats.moved << ", " << stats.unchanged << " unchanged\n";
+            }
 
-            cmake_gen.generate_all();
-            toolchain_gen.generate_all(output_path);
-            preset_gen.generate(output_path);
-            conan_gen.generate(output_path);
+            if (!render_cache_dir.empty()) {
+                scaffolder::TemplateEngine::shared().set_render_cache(
+                    std::make_shared<scaffolder::RenderCache>(fs::path(render_cache_dir)));
+            }
+            scaffolder::CmakeGenerator cmake_gen(index, path_resolver, output_path);
+            scaffolder::ToolchainGenerator toolchain_gen(index);
+            scaffolder::PresetGenerator preset_gen(index);
+            scaffolder::ConanGenerator conan_gen(index);
 
-            if (fs::exists(cache_dir)) {
-                fs::remove_all(cache_dir);
+            // Renders depend on the metadata, the templates and (for CMakeLists.txt) the copied files.
+            // The loaded metadata is hashed rather than its files, since ${VAR} values come from the environment.
+            std::string generate_key = scaffolder::Fnv1a()
+                .field(scaffolder::dump_metadata(metadata))
+                .field(scaffolder::TemplateEngine::shared().fingerprint())
+                .hex();
+            auto render_key = [&](const scaffolder::SwComponent& comp) {
+                auto it = copy_keys.find(comp.id);
+                return scaffolder::Fnv1a().field(generate_key).field(it == copy_keys.end() ? "" : it->second).hex();
+            };
+            scaffolder::RenderHooks render_hooks;
+            render_hooks.is_current = [&](const scaffolder::SwComponent& comp) {
+                return comp.dest && fs::exists(output_path / *comp.dest / "CMakeLists.txt") &&
+                       journal.is_done("render", comp.id, render_key(comp));
+            };
+            render_hooks.rendered = [&](const scaffolder::SwComponent& comp) {
+                journal.mark_done("render", comp.id, render_key(comp));
+            };
+            cmake_gen.generate_all(render_hooks, copy_options.jobs);
+            // Toolchain files and presets also depend on --toolchain-files.
+            std::string toolchains_key = scaffolder::Fnv1a().field(generate_key).field(toolchain_files_mode).hex();
+            // A stage is skipped only when it is journaled with the same key and its outputs still exist.
+            auto run_stage = [&](const std::string& stage, const std::string& key, const std::vector<fs::path>& outputs,
+                                 const std::function<void()>& run) {
+                bool present = std::all_of(outputs.begin(), outputs.end(), [](const fs::path& p) { return fs::exists(p); });
+                if (present && journal.is_done("stage", stage, key)) return;
+                run();
+                journal.mark_done("stage", stage, key);
+            };
+            bool referenced_only = toolchain_files_mode == "referenced";
+            scaffolder::ToolchainFiles toolchain_files;
+            std::vector<fs::path> toolchain_outputs;
+            if (referenced_only) {
+                toolchain_files = toolchain_gen.referenced_files(preset_gen.compute_combinations());
+                for (const auto& entry : toolchain_files) toolchain_outputs.push_back(output_path / "toolchains" / entry.second);
+            } else {
+                for (const auto& file : toolchain_gen.all_files()) toolchain_outputs.push_back(output_path / "toolchains" / file);
             }
+            run_stage("toolchains", toolchains_key, toolchain_outputs, [&] {
+                if (referenced_only)
+                    toolchain_gen.generate(output_path, toolchain_files, copy_options.jobs);
+                else
+                    toolchain_gen.generate_all(output_path, copy_options.jobs);
+            });
+            run_stage("presets", toolchains_key, {output_path / "CMakePresets.json"},
+                      [&] { preset_gen.generate(output_path, referenced_only ? &toolchain_files : nullptr); });
+            run_stage("conan", generate_key, {output_path / "conanfile.txt"}, [&] { conan_gen.generate(output_path); });
 
+            scaffolder::WriteStats writes = scaffolder::TemplateEngine::shared().write_stats();
+            std::cout << "Generated files: " << writes.created << " new, " << writes.changed << " changed, "
+                      << writes.unchanged << " unchanged";
+            if (writes.cached) std::cout << " (" << writes.cached << " from render cache)";
+            std::cout << "\n";
             std::cout << "Scaffolding complete: " << output_path.string() << "\n";
             return 0;
         } catch (const scaffolder::ConfigLoadError& e) {
             std::cerr << "Config load error: " << e.what() << "\n";
             return 1;
-        } catch (const scaffolder::ResolveError& e) {
-            std::cerr << "Resolve error: " << e.what() << "\n";
-            return 1;
         } catch (const scaffolder::ValidationError& e) {
             std::cerr << "Validation error: " << e.what() << "\n";
             return 1;
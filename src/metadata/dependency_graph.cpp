@@ -0,0 +1,109 @@
+#include "metadata/dependency_graph.hpp"
+#include "metadata/metadata_index.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+namespace scaffolder {
+
+namespace {
+
+using Edges = std::vector<std::vector<uint32_t>>;
+
+// Tarjan's algorithm with an explicit stack, so long chains cannot overflow the call stack. Roots
+// and edges are visited in order, and a component is emitted once every component it reaches is,
+// so the result lists the targets of edges first. Members are sorted by node.
+std::vector<std::vector<uint32_t>> strongly_connected(const Edges& edges) {
+    constexpr uint32_t kUnvisited = std::numeric_limits<uint32_t>::max();
+    const uint32_t n = static_cast<uint32_t>(edges.size());
+    std::vector<uint32_t> order(n, kUnvisited), low(n, 0);
+    std::vector<bool> on_stack(n, false);
+    std::vector<uint32_t> stack;
+    std::vector<std::pair<uint32_t, size_t>> calls;  // node, next edge to follow
+    std::vector<std::vector<uint32_t>> result;
+    uint32_t counter = 0;
+
+    for (uint32_t root = 0; root < n; ++root) {
+        if (order[root] != kUnvisited) continue;
+        calls.emplace_back(root, 0);
+        while (!calls.empty()) {
+            auto& [v, next] = calls.back();
+            if (next == 0) {
+                order[v] = low[v] = counter++;
+                stack.push_back(v);
+                on_stack[v] = true;
+            }
+            if (next < edges[v].size()) {
+                uint32_t w = edges[v][next++];
+                if (order[w] == kUnvisited) {
+                    calls.emplace_back(w, 0);
+                } else if (on_stack[w]) {
+                    low[v] = std::min(low[v], order[w]);
+                }
+                continue;
+            }
+            if (low[v] == order[v]) {
+                std::vector<uint32_t> scc;
+                uint32_t w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    on_stack[w] = false;
+                    scc.push_back(w);
+                } while (w != v);
+                std::sort(scc.begin(), scc.end());
+                result.push_back(std::move(scc));
+            }
+            uint32_t done = v;
+            calls.pop_back();
+            if (!calls.empty()) low[calls.back().first] = std::min(low[calls.back().first], low[done]);
+        }
+    }
+    return result;
+}
+
+// Flattens the strongly connected components into order and collects the cyclic ones.
+template <typename T>
+void collect(const std::vector<T>& nodes, const Edges& edges, std::vector<const T*>& order,
+             DependencyGraph::Cycles<T>& cycles) {
+    order.reserve(nodes.size());
+    for (const auto& scc : strongly_connected(edges)) {
+        std::vector<const T*> members;
+        members.reserve(scc.size());
+        for (uint32_t i : scc) members.push_back(&nodes[i]);
+        order.insert(order.end(), members.begin(), members.end());
+        bool self_loop = std::find(edges[scc[0]].begin(), edges[scc[0]].end(), scc[0]) != edges[scc[0]].end();
+        if (scc.size() > 1 || self_loop) cycles.push_back(std::move(members));
+    }
+}
+
+}  // namespace
+
+DependencyGraph::DependencyGraph(const MetadataIndex& index) {
+    const Metadata& metadata = index.metadata();
+
+    const auto& components = metadata.source_tree.components;
+    Edges depends_on(components.size());
+    for (size_t i = 0; i < components.size(); ++i) {
+        if (!components[i].dependencies) continue;
+        for (const auto& dep : *components[i].dependencies) {
+            if (const SwComponent* target = index.component(dep)) {
+                depends_on[i].push_back(static_cast<uint32_t>(target - components.data()));
+            }
+        }
+    }
+    collect(components, depends_on, component_order_, component_cycles_);
+
+    const auto& variants = metadata.build_variants;
+    Edges inherits(variants.size());
+    for (size_t i = 0; i < variants.size(); ++i) {
+        if (!variants[i].inherits) continue;
+        if (const BuildVariant* base = index.build_variant(*variants[i].inherits)) {
+            inherits[i].push_back(static_cast<uint32_t>(base - variants.data()));
+        }
+    }
+    collect(variants, inherits, build_variant_order_, inheritance_cycles_);
+}
+
+}  // namespace scaffolder
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "schema.hpp"
+#include <vector>
+
+namespace scaffolder {
+
+class MetadataIndex;
+
+/** The component dependency graph and the build-variant inheritance graph of a MetadataIndex,
+ *  split into strongly connected components (Tarjan) in one linear pass each. References to
+ *  unknown ids are ignored; the validator reports them. */
+class DependencyGraph {
+public:
+    template <typename T>
+    using Cycles = std::vector<std::vector<const T*>>;
+
+    explicit DependencyGraph(const MetadataIndex& index);
+
+    /** Every component after the components it depends on. Members of a cycle are adjacent, in
+     *  metadata order. */
+    const std::vector<const SwComponent*>& component_order() const { return component_order_; }
+    /** Every build variant after the variant it inherits; cycles as for component_order(). */
+    const std::vector<const BuildVariant*>& build_variant_order() const { return build_variant_order_; }
+
+    /** Each set of components that depend on each other, including one that depends on itself,
+     *  with members in metadata order; the sets follow component_order(). */
+    const Cycles<SwComponent>& component_cycles() const { return component_cycles_; }
+    const Cycles<BuildVariant>& inheritance_cycles() const { return inheritance_cycles_; }
+
+private:
+    std::vector<const SwComponent*> component_order_;
+    std::vector<const BuildVariant*> build_variant_order_;
+    Cycles<SwComponent> component_cycles_;
+    Cycles<BuildVariant> inheritance_cycles_;
+};
+
+}  // namespace scaffolder
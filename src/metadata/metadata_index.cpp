@@ -0,0 +1,68 @@
+#include "metadata/metadata_index.hpp"
+
+namespace scaffolder {
+
+namespace {
+
+template <typename T>
+void index_by_id(const std::vector<T>& entities, std::unordered_map<std::string, const T*>& out) {
+    out.reserve(entities.size());
+    for (const auto& e : entities) out.emplace(e.id, &e);  // keeps the first of repeated ids
+}
+
+template <typename T>
+const T* lookup(const std::unordered_map<std::string, const T*>& map, const std::string& id) {
+    auto it = map.find(id);
+    return it != map.end() ? it->second : nullptr;
+}
+
+const std::vector<const SwComponent*>& lookup_list(
+    const std::unordered_map<std::string, std::vector<const SwComponent*>>& map, const std::string& id) {
+    static const std::vector<const SwComponent*> kNone;
+    auto it = map.find(id);
+    return it != map.end() ? it->second : kNone;
+}
+
+}  // namespace
+
+MetadataIndex::MetadataIndex(const Metadata& metadata) : metadata_(metadata) {
+    const auto& components = metadata.source_tree.components;
+    index_by_id(components, components_);
+    index_by_id(metadata.socs, socs_);
+    index_by_id(metadata.boards, boards_);
+    index_by_id(metadata.toolchains, toolchains_);
+    index_by_id(metadata.isa_variants, isa_variants_);
+    index_by_id(metadata.build_variants, build_variants_);
+
+    for (const auto& c : components) {
+        if (c.dependencies) {
+            for (const auto& dep : *c.dependencies) dependents_[dep].push_back(&c);
+        }
+        if (c.type == "layer" && c.subdirs && components_.at(c.id) == &c) {
+            auto& kids = children_[c.id];
+            for (const auto& sub : *c.subdirs) {
+                if (const SwComponent* child = component(sub)) kids.push_back(child);
+            }
+        }
+    }
+    graph_ = std::make_unique<const DependencyGraph>(*this);
+}
+
+MetadataIndex::~MetadataIndex() = default;
+
+const SwComponent* MetadataIndex::component(const std::string& id) const { return lookup(components_, id); }
+const Soc* MetadataIndex::soc(const std::string& id) const { return lookup(socs_, id); }
+const Board* MetadataIndex::board(const std::string& id) const { return lookup(boards_, id); }
+const Toolchain* MetadataIndex::toolchain(const std::string& id) const { return lookup(toolchains_, id); }
+const IsaVariant* MetadataIndex::isa_variant(const std::string& id) const { return lookup(isa_variants_, id); }
+const BuildVariant* MetadataIndex::build_variant(const std::string& id) const { return lookup(build_variants_, id); }
+
+const std::vector<const SwComponent*>& MetadataIndex::dependents(const std::string& id) const {
+    return lookup_list(dependents_, id);
+}
+
+const std::vector<const SwComponent*>& MetadataIndex::children(const std::string& layer_id) const {
+    return lookup_list(children_, layer_id);
+}
+
+}  // namespace scaffolder
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "dependency_graph.hpp"
+#include "schema.hpp"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace scaffolder {
+
+/** Hash lookups over a parsed Metadata, built once and shared by the resolver and all generators.
+ *  Holds pointers into the metadata, which must outlive the index and not change. Where ids repeat,
+ *  the first entity with the id is indexed (the validator rejects repeated component ids). */
+class MetadataIndex {
+public:
+    explicit MetadataIndex(const Metadata& metadata);
+    MetadataIndex(Metadata&&) = delete;
+    ~MetadataIndex();
+
+    const Metadata& metadata() const { return metadata_; }
+
+    /** The entity with id, or nullptr. */
+    const SwComponent* component(const std::string& id) const;
+    const Soc* soc(const std::string& id) const;
+    const Board* board(const std::string& id) const;
+    const Toolchain* toolchain(const std::string& id) const;
+    const IsaVariant* isa_variant(const std::string& id) const;
+    const BuildVariant* build_variant(const std::string& id) const;
+
+    /** Components that list id in their dependencies, in metadata order. */
+    const std::vector<const SwComponent*>& dependents(const std::string& id) const;
+    /** The components a layer's subdirs name, in subdir order; unknown ids are left out. */
+    const std::vector<const SwComponent*>& children(const std::string& layer_id) const;
+
+    /** Dependency order and cycles of components and build variants, computed with the index. */
+    const DependencyGraph& graph() const { return *graph_; }
+
+private:
+    template <typename T>
+    using ById = std::unordered_map<std::string, const T*>;
+    using Components = std::unordered_map<std::string, std::vector<const SwComponent*>>;
+
+    const Metadata& metadata_;
+    ById<SwComponent> components_;
+    ById<Soc> socs_;
+    ById<Board> boards_;
+    ById<Toolchain> toolchains_;
+    ById<IsaVariant> isa_variants_;
+    ById<BuildVariant> build_variants_;
+    Components dependents_;
+    Components children_;
+    std::unique_ptr<const DependencyGraph> graph_;
+};
+
+}  // namespace scaffolder
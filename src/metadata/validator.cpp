@@ -1,14 +1,37 @@
 #include "metadata/validator.hpp"
+#include "util/thread_pool.hpp"
 #include <algorithm>
-#include <unordered_set>
+#include <iterator>
 
 namespace scaffolder {
 
-void Validator::validate(const Metadata& metadata) {
+void Validator::validate(const Metadata& metadata, unsigned jobs) {
+    validate(MetadataIndex(metadata), jobs);
+}
+
+void Validator::validate(const MetadataIndex& index, unsigned jobs) {
+    using Check = void (*)(const MetadataIndex&, Errors&);
+    static const Check kChecks[] = {validate_project, validate_components, validate_platforms,
+                                    validate_preset_matrix, validate_build_variants};
+    constexpr size_t kCount = std::size(kChecks);
+
+    // Each group writes its own list; they are joined in group order.
+    std::vector<Errors> found(kCount);
+    unsigned workers = std::min<unsigned>(ThreadPool::resolve_jobs(jobs), kCount);
+    if (workers <= 1) {
+        for (size_t i = 0; i < kCount; ++i) kChecks[i](index, found[i]);
+    } else {
+        ThreadPool pool(workers);
+        for (size_t i = 0; i < kCount; ++i) {
+            pool.submit([&index, &found, i] { kChecks[i](index, found[i]); });
+        }
+        pool.wait();
+    }
+
     errors_.clear();
-    validate_project(metadata.project);
-    validate_components(metadata.source_tree.components);
-    validate_preset_matrix(metadata.preset_matrix);
+    for (auto& group : found) {
+        errors_.insert(errors_.end(), std::make_move_iterator(group.begin()), std::make_move_iterator(group.end()));
+    }
     if (!errors_.empty()) {
         std::string msg;
         for (const auto& e : errors_) msg += e + "; ";
@@ -16,45 +39,102 @@ void Validator::validate(const Metadata& metadata) {
     }
 }
 
-void Validator::validate_project(const Project& p) {
-    if (p.name.empty()) errors_.push_back("project.name is required");
-    if (p.version.empty()) errors_.push_back("project.version is required");
+void Validator::validate_project(const MetadataIndex& index, Errors& errors) {
+    const Project& p = index.metadata().project;
+    if (p.name.empty()) errors.push_back("project.name is required");
+    if (p.version.empty()) errors.push_back("project.version is required");
 }
 
-void Validator::validate_components(const std::vector<SwComponent>& components) {
-    std::unordered_set<std::string> ids;
+void Validator::validate_components(const MetadataIndex& index, Errors& errors) {
+    const auto& components = index.metadata().source_tree.components;
     for (const auto& c : components) {
-        if (c.id.empty()) errors_.push_back("component id is required");
-        if (ids.count(c.id)) errors_.push_back("duplicate component id: " + c.id);
-        ids.insert(c.id);
+        if (c.id.empty()) errors.push_back("component id is required");
+        // The index keeps the first component of each id.
+        if (index.component(c.id) != &c) errors.push_back("duplicate component id: " + c.id);
 
-        if (c.type == "executable" && !c.source && !c.git) errors_.push_back("executable " + c.id + " requires source or git");
+        if (c.type == "executable" && !c.source && !c.git) errors.push_back("executable " + c.id + " requires source or git");
         if (c.type == "library" && !c.source && !c.git && c.structure != "hierarchical") {
-            if (c.library_type != "interface") errors_.push_back("library " + c.id + " requires source or git");
+            if (c.library_type != "interface") errors.push_back("library " + c.id + " requires source or git");
         }
-        if (c.type == "variant" && !c.source && !c.git) errors_.push_back("variant " + c.id + " requires source or git");
-        if (c.git && c.git->url.empty()) errors_.push_back("component " + c.id + " git.url is required");
-        if (c.type == "external" && !c.conan_ref) errors_.push_back("external " + c.id + " requires conan_ref");
-        if (c.type == "variant" && (!c.variations || c.variations->empty())) errors_.push_back("variant " + c.id + " requires variations");
-        if (c.type == "layer" && (!c.subdirs || c.subdirs->empty())) errors_.push_back("layer " + c.id + " requires subdirs");
+        if (c.type == "variant" && !c.source && !c.git) errors.push_back("variant " + c.id + " requires source or git");
+        if (c.git && c.git->url.empty()) errors.push_back("component " + c.id + " git.url is required");
+        if (c.type == "external" && !c.conan_ref) errors.push_back("external " + c.id + " requires conan_ref");
+        if (c.type == "variant" && (!c.variations || c.variations->empty())) errors.push_back("variant " + c.id + " requires variations");
+        if (c.type == "layer" && (!c.subdirs || c.subdirs->empty())) errors.push_back("layer " + c.id + " requires subdirs");
     }
 
     for (const auto& c : components) {
         if (c.dependencies) {
             for (const auto& dep : *c.dependencies) {
-                if (!ids.count(dep)) errors_.push_back("component " + c.id + " depends on unknown " + dep);
+                if (!index.component(dep)) errors.push_back("component " + c.id + " depends on unknown " + dep);
             }
         }
         if (c.subdirs) {
             for (const auto& sub : *c.subdirs) {
-                if (!ids.count(sub)) errors_.push_back("layer " + c.id + " references unknown subdir " + sub);
+                if (!index.component(sub)) errors.push_back("layer " + c.id + " references unknown subdir " + sub);
             }
         }
     }
+
+    for (const auto& cycle : index.graph().component_cycles()) {
+        if (cycle.size() == 1) {
+            errors.push_back("component " + cycle[0]->id + " depends on itself");
+            continue;
+        }
+        std::string members;
+        for (const SwComponent* c : cycle) members += (members.empty() ? "" : ", ") + c->id;
+        errors.push_back("dependency cycle between components " + members);
+    }
 }
 
-void Validator::validate_preset_matrix(const PresetMatrix& pm) {
-    if (pm.dimensions.empty()) errors_.push_back("preset_matrix.dimensions is required");
+void Validator::validate_platforms(const MetadataIndex& index, Errors& errors) {
+    const Metadata& metadata = index.metadata();
+    for (const auto& iv : metadata.isa_variants) {
+        if (!iv.toolchain.empty() && !index.toolchain(iv.toolchain)) {
+            errors.push_back("ISA variant '" + iv.id + "' references toolchain '" + iv.toolchain + "' which does not exist.");
+        }
+    }
+    for (const auto& b : metadata.boards) {
+        for (const auto& soc_id : b.socs) {
+            if (!index.soc(soc_id)) errors.push_back("Board '" + b.id + "' references SOC '" + soc_id + "' which does not exist.");
+        }
+    }
+}
+
+void Validator::validate_preset_matrix(const MetadataIndex& index, Errors& errors) {
+    const PresetMatrix& pm = index.metadata().preset_matrix;
+    if (pm.dimensions.empty()) errors.push_back("preset_matrix.dimensions is required");
+    for (const auto& ex : pm.exclude) {
+        if (ex.board && !index.board(*ex.board)) {
+            errors.push_back("Preset exclude references board '" + *ex.board + "' which does not exist.");
+        }
+        if (ex.soc && !index.soc(*ex.soc)) {
+            errors.push_back("Preset exclude references SOC '" + *ex.soc + "' which does not exist.");
+        }
+        if (ex.isa_variant && !index.isa_variant(*ex.isa_variant)) {
+            errors.push_back("Preset exclude references isa_variant '" + *ex.isa_variant + "' which does not exist.");
+        }
+        if (ex.build_variant && !index.build_variant(*ex.build_variant)) {
+            errors.push_back("Preset exclude references build_variant '" + *ex.build_variant + "' which does not exist.");
+        }
+    }
+}
+
+void Validator::validate_build_variants(const MetadataIndex& index, Errors& errors) {
+    for (const auto& bv : index.metadata().build_variants) {
+        if (bv.inherits && !index.build_variant(*bv.inherits)) {
+            errors.push_back("Build variant '" + bv.id + "' inherits '" + *bv.inherits + "' which does not exist.");
+        }
+    }
+    for (const auto& cycle : index.graph().inheritance_cycles()) {
+        if (cycle.size() == 1) {
+            errors.push_back("Build variant '" + cycle[0]->id + "' inherits itself.");
+            continue;
+        }
+        std::string members;
+        for (const BuildVariant* bv : cycle) members += (members.empty() ? "'" : ", '") + bv->id + "'";
+        errors.push_back("Build variants " + members + " inherit from each other in a cycle.");
+    }
 }
 
 }  // namespace scaffolder
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "metadata_index.hpp"
 #include "schema.hpp"
 #include <stdexcept>
 #include <string>
@@ -12,16 +13,26 @@ public:
     explicit ValidationError(const std::string& msg) : std::runtime_error(msg) {}
 };
 
+/** Checks required fields and every reference between entities in one pass over one index.
+ *  Errors are kept per instance, so separate validators may run concurrently. */
 class Validator {
 public:
-    void validate(const Metadata& metadata);
+    /** Throws ValidationError listing all errors. The independent check groups (project, components,
+     *  platforms, preset matrix, build variants) run on up to jobs workers (0 = one per hardware
+     *  thread); the errors and their order do not depend on jobs. */
+    void validate(const Metadata& metadata, unsigned jobs = 1);
+    void validate(const MetadataIndex& index, unsigned jobs = 1);
     std::vector<std::string> errors() const { return errors_; }
 
 private:
-    void validate_project(const Project& p);
-    void validate_components(const std::vector<SwComponent>& components);
-    void validate_preset_matrix(const PresetMatrix& pm);
-    std::vector<std::string> errors_;
+    using Errors = std::vector<std::string>;
+
+    static void validate_project(const MetadataIndex& index, Errors& errors);
+    static void validate_components(const MetadataIndex& index, Errors& errors);
+    static void validate_platforms(const MetadataIndex& index, Errors& errors);
+    static void validate_preset_matrix(const MetadataIndex& index, Errors& errors);
+    static void validate_build_variants(const MetadataIndex& index, Errors& errors);
+    Errors errors_;
 };
 
 }  // namespace scaffolder
@@ -0,0 +1,386 @@
+#include "resolver/git_cache.hpp"
+#include "util/cache_dir.hpp"
+#include "util/file_lock.hpp"
+#include "util/hash.hpp"
+#include "util/process.hpp"
+#include "util/thread_pool.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace scaffolder {
+
+namespace {
+
+ProcessResult run_git(const std::filesystem::path& mirror, std::vector<std::string> args) {
+    args.insert(args.begin(), {"git", "--git-dir=" + mirror.string()});
+    return run_process(args);
+}
+
+std::string trim_end(std::string s) {
+    while (!s.empty() && (s.back() == '\n' || s.back() == '\r' || s.back() == ' ')) s.pop_back();
+    return s;
+}
+
+// Last line git wrote to stderr, which carries the reason ("fatal: repository ... not found").
+std::string reason(const ProcessResult& r) {
+    std::string err = trim_end(r.err);
+    size_t nl = err.find_last_of('\n');
+    if (nl != std::string::npos) err = err.substr(nl + 1);
+    return err.empty() ? "git exited with status " + std::to_string(r.exit_code) : err;
+}
+
+// Unique suffix for temporary names, so concurrent runs sharing the cache do not collide.
+std::string unique_suffix() {
+    Fnv1a hash;
+    hash.field(static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+    hash.field(static_cast<uint64_t>(std::hash<std::thread::id>()(std::this_thread::get_id())));
+    return hash.hex();
+}
+
+void touch(const std::filesystem::path& stamp) {
+    if (!std::filesystem::exists(stamp)) std::ofstream(stamp).put('\n');
+    std::error_code ec;
+    std::filesystem::last_write_time(stamp, std::filesystem::file_time_type::clock::now(), ec);
+}
+
+std::filesystem::path stamp_of(const std::filesystem::path& p) {
+    std::filesystem::path stamp = p;
+    stamp += ".stamp";
+    return stamp;
+}
+
+}  // namespace
+
+GitCache::GitCache(const std::filesystem::path& root, bool refresh_branches)
+    : root_(root), refresh_branches_(refresh_branches) {}
+
+std::filesystem::path GitCache::default_root() {
+    return user_cache_dir("CMAKEGEN_GIT_CACHE", "git");
+}
+
+std::string GitCache::ref_spec(const GitSource& git) const {
+    if (git.tag) return *git.tag;
+    if (git.branch) return *git.branch;
+    if (git.commit) return *git.commit;
+    return "main";
+}
+
+std::string GitCache::cache_key(const std::string& url) const {
+    // Readable repository name plus a hash of the full URL, which is what identifies the mirror.
+    std::string name = url;
+    while (!name.empty() && name.back() == '/') name.pop_back();
+    size_t slash = name.find_last_of("/:\\");
+    if (slash != std::string::npos) name = name.substr(slash + 1);
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".git") == 0) name.resize(name.size() - 4);
+    for (char& c : name) {
+        bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.';
+        if (!safe) c = '_';
+    }
+    return (name.empty() ? "repo" : name) + "-" + Fnv1a().update(url).hex();
+}
+
+std::filesystem::path GitCache::ensure_mirror(const GitSource& git, const std::string& key, const std::string& component_id) {
+    std::filesystem::path mirror = root_ / "mirrors" / (key + ".git");
+    if (std::filesystem::exists(mirror / "HEAD")) return mirror;
+
+    // Clone next to the final name and rename, so an interrupted clone is never taken for a mirror.
+    std::filesystem::create_directories(mirror.parent_path());
+    std::filesystem::path tmp = mirror;
+    tmp += ".tmp-" + unique_suffix();
+    // A mirror in all but the fetch: a partial clone, so file contents are only downloaded for the
+    // commits and paths that are checked out.
+    std::vector<std::vector<std::string>> setup = {
+        {"git", "init", "--quiet", "--bare", tmp.string()},
+        {"git", "--git-dir=" + tmp.string(), "config", "remote.origin.url", git.url},
+        {"git", "--git-dir=" + tmp.string(), "config", "remote.origin.fetch", "+refs/*:refs/*"},
+        {"git", "--git-dir=" + tmp.string(), "config", "remote.origin.mirror", "true"},
+        {"git", "--git-dir=" + tmp.string(), "config", "remote.origin.promisor", "true"},
+        {"git", "--git-dir=" + tmp.string(), "config", "remote.origin.partialclonefilter", "blob:none"},
+    };
+    ProcessResult cloned;
+    for (const auto& args : setup) {
+        cloned = run_process(args);
+        if (!cloned.ok()) break;
+    }
+    if (cloned.ok()) cloned = fetch(tmp, git);
+    if (!cloned.ok()) {
+        std::filesystem::remove_all(tmp);
+        throw std::runtime_error("git clone failed for " + component_id + ": " + git.url + ": " + reason(cloned));
+    }
+    {
+        // Just fetched, so there is nothing to refresh.
+        std::lock_guard<std::mutex> lock(mutex_);
+        refreshed_.insert(mirror.string());
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, mirror, ec);
+    if (ec) {
+        std::filesystem::remove_all(tmp);
+        // Another run sharing the cache created it first.
+        if (!std::filesystem::exists(mirror / "HEAD")) {
+            throw std::runtime_error("cannot create git mirror " + mirror.string() + ": " + ec.message());
+        }
+    }
+    return mirror;
+}
+
+ProcessResult GitCache::fetch(const std::filesystem::path& mirror, const GitSource& git) const {
+    // A pinned commit is fetched alone and without history; servers that refuse commit ids get a full fetch.
+    if (git.commit && !git.tag && !git.branch) {
+        ProcessResult shallow = run_git(mirror, {"fetch", "--quiet", "--depth=1", "origin", *git.commit});
+        if (shallow.ok()) return shallow;
+    }
+    return run_git(mirror, {"fetch", "--quiet", "--prune", "origin"});
+}
+
+std::string GitCache::resolve(const std::filesystem::path& mirror, const std::string& ref) const {
+    ProcessResult r = run_git(mirror, {"rev-parse", "--verify", "--quiet", ref + "^{commit}"});
+    return r.ok() ? trim_end(r.out) : "";
+}
+
+std::string GitCache::commit_of(const GitSource& git, const std::filesystem::path& mirror,
+                                const std::string& component_id) {
+    std::string ref = ref_spec(git);
+    std::string sha = resolve(mirror, ref);
+    // A tag or commit in the mirror is final; a branch may have moved on since it was fetched.
+    bool is_branch = !git.tag && (git.branch || !git.commit);
+    bool refresh = false;
+    if (refresh_branches_ && is_branch && !sha.empty()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        refresh = refreshed_.insert(mirror.string()).second;
+    }
+    if (refresh) {
+        ProcessResult fetched = fetch(mirror, git);
+        if (!fetched.ok()) {
+            throw std::runtime_error("git fetch failed for " + component_id + ": " + git.url + " (ref: " + ref +
+                                     "): " + reason(fetched));
+        }
+        sha = resolve(mirror, ref);
+    }
+    if (sha.empty()) {
+        ProcessResult fetched = fetch(mirror, git);
+        sha = resolve(mirror, ref);
+        if (sha.empty()) {
+            throw std::runtime_error("git ref not found for " + component_id + ": " + git.url + " (ref: " + ref + ")" +
+                                     (fetched.ok() ? "" : ": " + reason(fetched)));
+        }
+    }
+    touch(stamp_of(mirror));
+    return sha;
+}
+
+std::filesystem::path GitCache::worktree_of(const std::string& key, const std::string& sha,
+                                           const std::vector<std::string>& sparse) const {
+    // Sparse worktrees are keyed by their patterns as well, since they hold only part of the commit.
+    std::string name = sha;
+    if (!sparse.empty()) {
+        Fnv1a hash;
+        for (const auto& pattern : sparse) hash.field(pattern);
+        name += "-" + hash.hex();
+    }
+    return root_ / "worktrees" / key / name;
+}
+
+std::filesystem::path GitCache::cached_checkout(const GitSource& git, const std::vector<std::string>& sparse) const {
+    std::string key = cache_key(git.url);
+    std::filesystem::path mirror = root_ / "mirrors" / (key + ".git");
+    if (!std::filesystem::exists(mirror / "HEAD")) return {};
+    std::string sha = resolve(mirror, ref_spec(git));
+    if (sha.empty()) return {};
+    std::filesystem::path worktree = worktree_of(key, sha, sparse);
+    return std::filesystem::exists(stamp_of(worktree)) ? worktree : std::filesystem::path();
+}
+
+std::filesystem::path GitCache::checkout(const GitSource& git, const std::string& component_id,
+                                        const std::vector<std::string>& sparse) {
+    std::string key = cache_key(git.url);
+    // Git work on one repository is serialized: between threads by the mutex, between runs sharing
+    // the cache by the lock file.
+    std::lock_guard<std::mutex> lock(repo_mutex(key));
+    FileLock repo_lock(lock_file(key));
+    std::filesystem::path mirror = ensure_mirror(git, key, component_id);
+    std::string sha = commit_of(git, mirror, component_id);
+
+    // The stamp is written once the worktree is complete. Since no other run can be adding it while
+    // the lock is held, a worktree without one is left over from an interrupted run.
+    std::filesystem::path worktree = worktree_of(key, sha, sparse);
+    std::filesystem::path stamp = stamp_of(worktree);
+    if (!std::filesystem::exists(stamp)) {
+        std::filesystem::create_directories(worktree.parent_path());
+        if (std::filesystem::exists(worktree)) {
+            std::filesystem::remove_all(worktree);
+            run_git(mirror, {"worktree", "prune"});
+        }
+        ProcessResult added = add_worktree(mirror, worktree, sha, sparse);
+        if (!added.ok() && !std::filesystem::exists(stamp)) {
+            throw std::runtime_error("git checkout failed for " + component_id + ": " + git.url + " (ref: " +
+                                     ref_spec(git) + "): " + reason(added));
+        }
+    }
+    touch(stamp);
+    return worktree;
+}
+
+ProcessResult GitCache::add_worktree(const std::filesystem::path& mirror, const std::filesystem::path& worktree,
+                                    const std::string& sha, const std::vector<std::string>& sparse) const {
+    if (sparse.empty()) return run_git(mirror, {"worktree", "add", "--quiet", "--detach", worktree.string(), sha});
+
+    ProcessResult r = run_git(mirror, {"worktree", "add", "--quiet", "--no-checkout", "--detach", worktree.string(), sha});
+    if (!r.ok()) return r;
+    // Non-cone patterns are per worktree, so other checkouts of the mirror stay complete.
+    std::vector<std::string> set = {"git", "-C", worktree.string(), "sparse-checkout", "set", "--no-cone"};
+    set.insert(set.end(), sparse.begin(), sparse.end());
+    r = run_process(set);
+    if (!r.ok()) return r;
+    return run_process({"git", "-C", worktree.string(), "checkout", "--quiet", "--detach", sha});
+}
+
+std::filesystem::path GitCache::stage(const GitSource& git, const std::string& component_id,
+                                     const std::vector<std::string>& sparse, const std::filesystem::path& parent) {
+    std::string key = cache_key(git.url);
+    std::lock_guard<std::mutex> lock(repo_mutex(key));
+    FileLock repo_lock(lock_file(key));
+    std::filesystem::path mirror = ensure_mirror(git, key, component_id);
+    std::string sha = commit_of(git, mirror, component_id);
+
+    std::filesystem::path dir = parent / (component_id + "-" + sha.substr(0, 12));
+    std::filesystem::path index = dir;
+    index += ".index";
+    std::filesystem::path paths = dir;
+    paths += ".paths";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    // A private index: read the commit's tree (no file contents needed), list the paths the
+    // patterns select, then check exactly those out, which fetches only their contents.
+    std::vector<std::string> env = {"GIT_INDEX_FILE=" + index.string()};
+    auto git_in = [&](const char* pathspecs, std::vector<std::string> args) {
+        args.insert(args.begin(), {"git", pathspecs, "--git-dir=" + mirror.string(), "--work-tree=" + dir.string()});
+        return run_process(args, env);
+    };
+    std::vector<std::string> ls = {"ls-files", "-z", "--"};
+    for (const auto& pattern : sparse) {
+        // Non-cone patterns as glob pathspecs: a pattern without '/' matches a name at any depth.
+        bool negated = pattern[0] == '!';
+        std::string glob = negated ? pattern.substr(1) : pattern;
+        if (glob.find('/') == std::string::npos) glob = "**/" + glob;
+        else if (glob[0] == '/') glob.erase(0, 1);
+        ls.push_back(negated ? ":(exclude)" + glob : glob);
+    }
+    ProcessResult r = git_in("--literal-pathspecs", {"read-tree", sha});
+    if (r.ok()) r = git_in("--glob-pathspecs", ls);
+    if (r.ok() && !r.out.empty()) {
+        std::ofstream(paths, std::ios::binary) << r.out;
+        r = git_in("--literal-pathspecs",
+                   {"checkout", "--quiet", "--pathspec-from-file=" + paths.string(), "--pathspec-file-nul"});
+    }
+    std::error_code ec;
+    std::filesystem::remove(index, ec);
+    std::filesystem::remove(paths, ec);
+    if (!r.ok()) {
+        std::filesystem::remove_all(dir);
+        throw std::runtime_error("git checkout failed for " + component_id + ": " + git.url + " (ref: " +
+                                 ref_spec(git) + "): " + reason(r));
+    }
+    return dir;
+}
+
+std::filesystem::path GitCache::lock_file(const std::string& key) const {
+    // Next to the mirror rather than in it, so it exists before the mirror is cloned. Lock files are
+    // never removed: a run waiting on a removed one would not exclude a run creating a new one.
+    std::filesystem::path mirrors = root_ / "mirrors";
+    std::filesystem::create_directories(mirrors);
+    return mirrors / (key + ".lock");
+}
+
+std::mutex& GitCache::repo_mutex(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& m = repo_mutexes_[key];
+    if (!m) m = std::make_unique<std::mutex>();
+    return *m;
+}
+
+std::vector<std::filesystem::path> GitCache::checkout_all(const std::vector<CheckoutRequest>& requests, unsigned jobs) {
+    std::vector<std::filesystem::path> worktrees(requests.size());
+    std::vector<std::string> errors(requests.size());
+    {
+        ThreadPool pool(std::max(1u, std::min<unsigned>(ThreadPool::resolve_jobs(jobs), static_cast<unsigned>(requests.size()))));
+        for (size_t i = 0; i < requests.size(); ++i) {
+            pool.submit([&, i] {
+                try {
+                    const CheckoutRequest& r = requests[i];
+                    worktrees[i] = r.stage_in.empty() ? checkout(r.git, r.component_id, r.sparse)
+                                                      : stage(r.git, r.component_id, r.sparse, r.stage_in);
+                } catch (const std::exception& e) {
+                    errors[i] = e.what();
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    size_t failed = 0;
+    std::string message;
+    for (const auto& e : errors) {
+        if (e.empty()) continue;
+        ++failed;
+        message += "\n  " + e;
+    }
+    if (failed > 0) {
+        throw std::runtime_error("git checkout failed for " + std::to_string(failed) + " of " +
+                                 std::to_string(requests.size()) + " components:" + message);
+    }
+    return worktrees;
+}
+
+GitCache::PruneStats GitCache::prune(std::chrono::hours max_age) {
+    PruneStats stats;
+    auto now = std::filesystem::file_time_type::clock::now();
+    auto is_stale = [&](const std::filesystem::path& p) {
+        std::error_code ec;
+        auto t = std::filesystem::last_write_time(p, ec);
+        return ec || now - t >= max_age;
+    };
+
+    auto subdirectories = [](const std::filesystem::path& dir) {
+        std::vector<std::filesystem::path> result;
+        if (!std::filesystem::exists(dir)) return result;
+        for (const auto& e : std::filesystem::directory_iterator(dir)) {
+            if (e.is_directory()) result.push_back(e.path());
+        }
+        return result;
+    };
+
+    std::filesystem::path worktrees = root_ / "worktrees";
+    std::filesystem::path mirrors = root_ / "mirrors";
+    for (const auto& repo : subdirectories(worktrees)) {
+        for (const auto& tree : subdirectories(repo)) {
+            if (!is_stale(stamp_of(tree))) continue;
+            std::filesystem::remove_all(tree);
+            std::filesystem::remove(stamp_of(tree));
+            ++stats.worktrees;
+        }
+        std::filesystem::path mirror = mirrors / (repo.filename().string() + ".git");
+        if (std::filesystem::exists(mirror)) run_git(mirror, {"worktree", "prune"});
+        if (std::filesystem::is_empty(repo)) std::filesystem::remove(repo);
+    }
+    for (const auto& mirror : subdirectories(mirrors)) {
+        if (mirror.extension() != ".git") {
+            // Leftover of an interrupted clone.
+            if (is_stale(mirror)) std::filesystem::remove_all(mirror);
+            continue;
+        }
+        if (std::filesystem::exists(worktrees / mirror.stem()) || !is_stale(stamp_of(mirror))) continue;
+        std::filesystem::remove_all(mirror);
+        std::filesystem::remove(stamp_of(mirror));
+        ++stats.mirrors;
+    }
+    return stats;
+}
+
+}  // namespace scaffolder
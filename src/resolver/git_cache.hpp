@@ -0,0 +1,97 @@
+#pragma once
+
+#include "../metadata/schema.hpp"
+#include "../util/process.hpp"
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace scaffolder {
+
+/** Persistent git cache shared by all generate runs. Each repository URL is kept once as a bare,
+ *  blobless (partial clone) mirror (mirrors/<name>-<hash>.git); each resolved commit is checked out
+ *  once as a detached worktree of that mirror (worktrees/<name>-<hash>/<sha>, or <sha>-<hash> for a
+ *  sparse checkout). The network is only used when the mirror is missing or does not contain the
+ *  requested tag, branch or commit, to refresh branches when asked to, and to download the contents
+ *  of checked out files. */
+class GitCache {
+public:
+    struct PruneStats {
+        size_t worktrees = 0;
+        size_t mirrors = 0;
+    };
+
+    struct CheckoutRequest {
+        std::string component_id;
+        GitSource git;
+        std::vector<std::string> sparse;
+        std::filesystem::path stage_in;  // when set, stage() into this directory instead of checkout()
+    };
+
+    /** With refresh_branches, a branch ref (including the default main) is fetched once per
+     *  mirror and cache object even when the mirror already has it, so it moves to the remote's
+     *  current commit. Tags and commits are only fetched when missing either way. */
+    explicit GitCache(const std::filesystem::path& root, bool refresh_branches = false);
+
+    /** $CMAKEGEN_GIT_CACHE, else $XDG_CACHE_HOME/cmakegen/git, else ~/.cache/cmakegen/git
+     *  (%LOCALAPPDATA%\cmakegen\git on Windows). */
+    static std::filesystem::path default_root();
+
+    /** Returns a worktree with the requested ref checked out. With sparse patterns (gitignore
+     *  syntax, see sparse_checkout_patterns) only matching files are checked out. The worktree is
+     *  shared and must be treated as read-only. Throws std::runtime_error when git fails.
+     *  Thread-safe; checkouts of the same repository are serialized. */
+    std::filesystem::path checkout(const GitSource& git, const std::string& component_id,
+                                   const std::vector<std::string>& sparse = {});
+
+    /** The worktree checkout() would return when the mirror already has the requested ref and the
+     *  worktree is complete; an empty path otherwise. Never fetches and never writes to the cache. */
+    std::filesystem::path cached_checkout(const GitSource& git, const std::vector<std::string>& sparse = {}) const;
+
+    /** Writes the files of the requested ref that match the sparse patterns into a fresh directory
+     *  <parent>/<component_id>-<short sha>, without a worktree or any copy in the cache. The caller
+     *  owns the result and may move files out of it. Throws std::runtime_error when git fails. */
+    std::filesystem::path stage(const GitSource& git, const std::string& component_id,
+                                const std::vector<std::string>& sparse, const std::filesystem::path& parent);
+
+    /** Checks out (or stages) every request with up to jobs (0 = one per hardware thread) running
+     *  at once and returns the directories in request order. A failure does not stop the other checkouts; all
+     *  failures are reported together in one std::runtime_error once every checkout finished. */
+    std::vector<std::filesystem::path> checkout_all(const std::vector<CheckoutRequest>& requests, unsigned jobs);
+
+    /** Removes worktrees not used for max_age, then mirrors left without worktrees and not used
+     *  for max_age. A zero max_age empties the cache. */
+    PruneStats prune(std::chrono::hours max_age);
+
+    const std::filesystem::path& root() const { return root_; }
+
+private:
+    std::string ref_spec(const GitSource& git) const;
+    std::string cache_key(const std::string& url) const;
+    std::filesystem::path ensure_mirror(const GitSource& git, const std::string& key, const std::string& component_id);
+    ProcessResult fetch(const std::filesystem::path& mirror, const GitSource& git) const;
+    std::string resolve(const std::filesystem::path& mirror, const std::string& ref) const;
+    std::filesystem::path worktree_of(const std::string& key, const std::string& sha,
+                                      const std::vector<std::string>& sparse) const;
+    /** Commit id of the requested ref, fetching when the mirror lacks it or a branch is refreshed. */
+    std::string commit_of(const GitSource& git, const std::filesystem::path& mirror, const std::string& component_id);
+    ProcessResult add_worktree(const std::filesystem::path& mirror, const std::filesystem::path& worktree,
+                               const std::string& sha, const std::vector<std::string>& sparse) const;
+    std::mutex& repo_mutex(const std::string& key);
+    /** mirrors/<key>.lock, which checkout() and stage() hold while they work on the repository. */
+    std::filesystem::path lock_file(const std::string& key) const;
+
+    std::filesystem::path root_;
+    bool refresh_branches_;
+    std::mutex mutex_;  // guards repo_mutexes_ and refreshed_
+    std::map<std::string, std::unique_ptr<std::mutex>> repo_mutexes_;
+    std::set<std::string> refreshed_;  // mirrors whose branches were fetched by this object
+};
+
+}  // namespace scaffolder
@@ -0,0 +1,21 @@
+#include "util/cache_dir.hpp"
+#include <cstdlib>
+
+namespace scaffolder {
+
+std::filesystem::path user_cache_dir(const char* env_var, const char* name) {
+    if (const char* env = std::getenv(env_var)) {
+        if (*env) return env;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    if (const char* local = std::getenv("LOCALAPPDATA")) return std::filesystem::path(local) / "cmakegen" / name;
+#else
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME")) {
+        if (*xdg) return std::filesystem::path(xdg) / "cmakegen" / name;
+    }
+    if (const char* home = std::getenv("HOME")) return std::filesystem::path(home) / ".cache" / "cmakegen" / name;
+#endif
+    return std::filesystem::temp_directory_path() / "cmakegen" / name;
+}
+
+}  // namespace scaffolder
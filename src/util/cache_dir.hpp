@@ -0,0 +1,11 @@
+#pragma once
+
+#include <filesystem>
+
+namespace scaffolder {
+
+/** Directory of a persistent cache: $<env_var> if set, else $XDG_CACHE_HOME/cmakegen/<name>, else
+ *  ~/.cache/cmakegen/<name> (%LOCALAPPDATA%\cmakegen\<name> on Windows). */
+std::filesystem::path user_cache_dir(const char* env_var, const char* name);
+
+}  // namespace scaffolder
@@ -0,0 +1,56 @@
+#include "util/file_lock.hpp"
+#include <stdexcept>
+#include <string>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace scaffolder {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+FileLock::FileLock(const std::filesystem::path& path) {
+    handle_ = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                          nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle_ == INVALID_HANDLE_VALUE) throw std::runtime_error("cannot open lock file: " + path.string());
+    OVERLAPPED whole{};
+    if (!LockFileEx(handle_, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &whole)) {
+        CloseHandle(handle_);
+        throw std::runtime_error("cannot lock " + path.string());
+    }
+}
+
+FileLock::~FileLock() {
+    OVERLAPPED whole{};
+    UnlockFileEx(handle_, 0, MAXDWORD, MAXDWORD, &whole);
+    CloseHandle(handle_);
+}
+
+#else
+
+FileLock::FileLock(const std::filesystem::path& path) {
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) throw std::runtime_error("cannot open lock file: " + path.string() + ": " + std::strerror(errno));
+    // flock, unlike fcntl locks, belongs to the open file, so two FileLocks in one process still conflict.
+    while (::flock(fd_, LOCK_EX) != 0) {
+        if (errno == EINTR) continue;
+        int err = errno;
+        ::close(fd_);
+        throw std::runtime_error("cannot lock " + path.string() + ": " + std::strerror(err));
+    }
+}
+
+FileLock::~FileLock() {
+    ::close(fd_);
+}
+
+#endif
+
+}  // namespace scaffolder
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <filesystem>
+
+namespace scaffolder {
+
+/** Exclusive advisory lock on a file, held for the lifetime of the object; blocks until it is free.
+ *  The file is created if missing and left in place. The operating system releases the lock when
+ *  the holder exits, so an interrupted run never leaves a repository locked. Locks taken through
+ *  separate FileLock objects exclude each other within one process as well.
+ *  Throws std::runtime_error when the file cannot be opened or locked. */
+class FileLock {
+public:
+    explicit FileLock(const std::filesystem::path& path);
+    ~FileLock();
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+private:
+#if defined(_WIN32) || defined(_WIN64)
+    void* handle_;
+#else
+    int fd_;
+#endif
+};
+
+}  // namespace scaffolder
@@ -0,0 +1,61 @@
+#include "util/file_write.hpp"
+#include <atomic>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+namespace scaffolder {
+
+namespace {
+
+bool same_content(const std::filesystem::path& path, std::string_view content) {
+    std::error_code ec;
+    if (std::filesystem::file_size(path, ec) != content.size() || ec) return false;
+    std::ifstream in(path, std::ios::binary);
+    char buf[16384];
+    size_t offset = 0;
+    while (in && offset < content.size()) {
+        in.read(buf, sizeof(buf));
+        size_t n = static_cast<size_t>(in.gcount());
+        if (n == 0 || content.compare(offset, n, std::string_view(buf, n)) != 0) return false;
+        offset += n;
+    }
+    return offset == content.size();
+}
+
+// Hidden sibling of path; the random start keeps two processes writing one output apart.
+std::filesystem::path temp_path_for(const std::filesystem::path& path) {
+    static std::atomic<unsigned long> counter{std::random_device{}()};
+    return path.parent_path() / ("." + path.filename().string() + ".cmakegen-tmp" + std::to_string(++counter));
+}
+
+}  // namespace
+
+WriteResult write_if_changed(const std::filesystem::path& path, std::string_view content) {
+    std::error_code ec;
+    bool exists = std::filesystem::is_regular_file(path, ec);
+    if (exists && same_content(path, content)) return WriteResult::Unchanged;
+
+    if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path());
+    std::filesystem::path tmp = temp_path_for(path);
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(content.data(), static_cast<std::streamsize>(content.size()));
+        out.close();
+        if (!out) {
+            std::filesystem::remove(tmp, ec);
+            throw std::runtime_error("cannot write " + path.string());
+        }
+    }
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        std::error_code ignored;
+        std::filesystem::remove(tmp, ignored);
+        throw std::runtime_error("cannot write " + path.string() + ": " + ec.message());
+    }
+    return exists ? WriteResult::Changed : WriteResult::Created;
+}
+
+}  // namespace scaffolder
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <filesystem>
+#include <string_view>
+
+namespace scaffolder {
+
+enum class WriteResult { Created, Changed, Unchanged };
+
+/** Writes content to path unless the file already holds exactly these bytes, in which case it is
+ *  left untouched (mtime included). A write goes to a temporary file next to path that is then
+ *  renamed over it, so readers never see a partial file. Creates missing parent directories.
+ *  Throws std::runtime_error on failure. */
+WriteResult write_if_changed(const std::filesystem::path& path, std::string_view content);
+
+}  // namespace scaffolder
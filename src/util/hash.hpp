@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace scaffolder {
+
+/** Incremental 64-bit FNV-1a, used to fingerprint inputs (not for security). */
+class Fnv1a {
+public:
+    Fnv1a& update(std::string_view bytes) {
+        for (unsigned char c : bytes) {
+            hash_ ^= c;
+            hash_ *= 0x100000001b3ULL;
+        }
+        return *this;
+    }
+
+    /** Adds a field; the terminator keeps ("ab", "c") and ("a", "bc") apart. */
+    Fnv1a& field(std::string_view bytes) {
+        update(bytes);
+        return update(std::string_view("\0", 1));
+    }
+
+    Fnv1a& field(uint64_t value) {
+        char bytes[8];
+        for (int i = 0; i < 8; ++i) bytes[i] = static_cast<char>(value >> (8 * i));
+        return update(std::string_view(bytes, sizeof(bytes)));
+    }
+
+    uint64_t value() const { return hash_; }
+
+    std::string hex() const {
+        char buf[17];
+        std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(hash_));
+        return buf;
+    }
+
+private:
+    uint64_t hash_ = 0xcbf29ce484222325ULL;
+};
+
+}  // namespace scaffolder
@@ -0,0 +1,162 @@
+#include "util/process.hpp"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_WIN32) || defined(_WIN64)
+#define popen _popen
+#define pclose _pclose
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+namespace scaffolder {
+
+#if defined(_WIN32) || defined(_WIN64)
+
+// No posix_spawn: go through the command interpreter, quoting every argument. stderr is merged into out.
+ProcessResult run_process(const std::vector<std::string>& argv, const std::vector<std::string>& env) {
+    if (argv.empty()) throw std::invalid_argument("run_process: empty argument list");
+    std::string cmd = "\"";
+    for (const auto& var : env) cmd += "set \"" + var + "\"&& ";
+    for (const auto& arg : argv) {
+        cmd += "\"";
+        for (char c : arg) cmd += c == '"' ? std::string("\\\"") : std::string(1, c);
+        cmd += "\" ";
+    }
+    cmd += "2>&1 <NUL\"";
+    ProcessResult result;
+    FILE* pipe = popen(cmd.c_str(), "r");
+    if (!pipe) {
+        result.exit_code = 127;
+        result.err = argv[0] + ": cannot start";
+        return result;
+    }
+    char buf[4096];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), pipe)) > 0) result.out.append(buf, n);
+    result.exit_code = pclose(pipe);
+    if (result.exit_code != 0) result.err = result.out;
+    return result;
+}
+
+#else
+
+namespace {
+
+// Close-on-exec from the start, so a child spawned concurrently by another thread cannot inherit
+// the write end and keep this pipe open after our own child exited.
+bool make_pipe(int fds[2]) {
+#if defined(__linux__)
+    return pipe2(fds, O_CLOEXEC) == 0;
+#else
+    if (pipe(fds) != 0) return false;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+#endif
+}
+
+// Reads both pipes until the child closes them; reading one to the end first could deadlock when
+// the child fills the other.
+void drain(int out_fd, int err_fd, ProcessResult& result) {
+    pollfd fds[2] = {{out_fd, POLLIN, 0}, {err_fd, POLLIN, 0}};
+    std::string* sinks[2] = {&result.out, &result.err};
+    int open = 2;
+    char buf[4096];
+    while (open > 0) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < 2; ++i) {
+            if (fds[i].fd < 0 || fds[i].revents == 0) continue;
+            ssize_t n = read(fds[i].fd, buf, sizeof(buf));
+            if (n > 0) {
+                sinks[i]->append(buf, static_cast<size_t>(n));
+            } else if (n == 0 || errno != EINTR) {
+                fds[i].fd = -1;
+                --open;
+            }
+        }
+    }
+}
+
+// The inherited environment with env applied on top; the pointers stay valid while env and environ do.
+std::vector<char*> make_environment(const std::vector<std::string>& env) {
+    std::vector<char*> result;
+    for (char** var = environ; *var; ++var) {
+        const char* eq = std::strchr(*var, '=');
+        size_t name = eq ? static_cast<size_t>(eq - *var) + 1 : std::strlen(*var);
+        bool replaced = false;
+        for (const auto& e : env) replaced = replaced || e.compare(0, name, *var, name) == 0;
+        if (!replaced) result.push_back(*var);
+    }
+    for (const auto& e : env) result.push_back(const_cast<char*>(e.c_str()));
+    result.push_back(nullptr);
+    return result;
+}
+
+}  // namespace
+
+ProcessResult run_process(const std::vector<std::string>& argv, const std::vector<std::string>& env) {
+    if (argv.empty()) throw std::invalid_argument("run_process: empty argument list");
+    ProcessResult result;
+    int out_pipe[2];
+    int err_pipe[2];
+    if (!make_pipe(out_pipe)) throw std::runtime_error("cannot create pipe: " + std::string(std::strerror(errno)));
+    if (!make_pipe(err_pipe)) {
+        int saved = errno;
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        throw std::runtime_error("cannot create pipe: " + std::string(std::strerror(saved)));
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, out_pipe[1], 1);
+    posix_spawn_file_actions_adddup2(&actions, err_pipe[1], 2);
+
+    std::vector<char*> args;
+    args.reserve(argv.size() + 1);
+    for (const auto& arg : argv) args.push_back(const_cast<char*>(arg.c_str()));
+    args.push_back(nullptr);
+
+    pid_t pid = 0;
+    std::vector<char*> envp = env.empty() ? std::vector<char*>() : make_environment(env);
+    int rc = posix_spawnp(&pid, args[0], &actions, nullptr, args.data(), env.empty() ? environ : envp.data());
+    posix_spawn_file_actions_destroy(&actions);
+    close(out_pipe[1]);
+    close(err_pipe[1]);
+    if (rc != 0) {
+        close(out_pipe[0]);
+        close(err_pipe[0]);
+        result.exit_code = 127;
+        result.err = argv[0] + ": " + std::strerror(rc);
+        return result;
+    }
+
+    drain(out_pipe[0], err_pipe[0], result);
+    close(out_pipe[0]);
+    close(err_pipe[0]);
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return result;
+    }
+    if (WIFEXITED(status)) result.exit_code = WEXITSTATUS(status);
+    else if (WIFSIGNALED(status)) result.exit_code = 128 + WTERMSIG(status);
+    return result;
+}
+
+#endif
+
+}  // namespace scaffolder
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace scaffolder {
+
+struct ProcessResult {
+    int exit_code = -1;  // 127 when the program could not be started
+    std::string out;
+    std::string err;
+
+    bool ok() const { return exit_code == 0; }
+};
+
+/** Runs argv[0], looked up in PATH, with argv[1..] passed verbatim (no shell, no quoting) and
+ *  stdin from the null device. env entries ("NAME=value") are added to the inherited environment,
+ *  replacing variables of the same name. Captures stdout and stderr. Safe to call from several threads. */
+ProcessResult run_process(const std::vector<std::string>& argv, const std::vector<std::string>& env = {});
+
+}  // namespace scaffolder
@@ -0,0 +1,67 @@
+#include "util/run_journal.hpp"
+#include "util/hash.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace scaffolder {
+
+RunJournal::RunJournal(const std::filesystem::path& output_dir, bool resume, bool record)
+    : path_(output_dir / kFileName), resume_(resume), record_(record) {
+    if (!resume) return;
+    std::ifstream in(path_);
+    std::string line;
+    while (std::getline(in, line)) {
+        nlohmann::json j = nlohmann::json::parse(line, nullptr, false);
+        if (j.is_discarded() || !j.is_object()) continue;
+        std::string kind = j.value("kind", "");
+        if (kind.empty()) continue;
+        done_[{kind, j.value("name", "")}] = j.value("fingerprint", "");
+    }
+}
+
+bool RunJournal::is_done(const std::string& kind, const std::string& name, const std::string& fingerprint) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = done_.find({kind, name});
+    return it != done_.end() && it->second == fingerprint;
+}
+
+void RunJournal::mark_done(const std::string& kind, const std::string& name, const std::string& fingerprint) {
+    if (!record_) return;
+    nlohmann::json j = {{"kind", kind}, {"name", name}, {"fingerprint", fingerprint}};
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!out_.is_open()) {
+        std::filesystem::create_directories(path_.parent_path());
+        out_.open(path_, resume_ ? std::ios::app : std::ios::trunc);
+        if (!out_) throw std::runtime_error("cannot write journal: " + path_.string());
+        // A torn line left by a crash must not swallow the first record appended now.
+        if (resume_) out_ << "\n";
+    }
+    done_[{kind, name}] = fingerprint;
+    out_ << j.dump() << "\n";
+    out_.flush();
+    if (!out_) throw std::runtime_error("cannot write journal: " + path_.string());
+}
+
+std::string fingerprint_tree(const std::filesystem::path& dir) {
+    std::vector<std::filesystem::path> files;
+    std::error_code ec;
+    if (std::filesystem::is_directory(dir, ec)) {
+        for (const auto& e : std::filesystem::recursive_directory_iterator(dir)) {
+            if (e.is_regular_file()) files.push_back(e.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    Fnv1a hash;
+    for (const auto& f : files) {
+        std::ifstream in(f, std::ios::binary);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        hash.field(std::filesystem::relative(f, dir).generic_string()).field(ss.str());
+    }
+    return hash.hex();
+}
+
+}  // namespace scaffolder
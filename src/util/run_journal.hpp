@@ -0,0 +1,42 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace scaffolder {
+
+/** Append-only record of the work a generate run has completed, kept in the output directory so
+ *  an interrupted run can be resumed. Each line is a JSON object {"kind", "name", "fingerprint"};
+ *  work counts as done only while its fingerprint (a hash of its inputs) is unchanged. A torn
+ *  last line from a crash is ignored. Thread-safe. */
+class RunJournal {
+public:
+    static constexpr const char* kFileName = ".cmakegen_journal";
+
+    /** With resume the existing journal is loaded and extended; otherwise it is started afresh on
+     *  the first record. With record = false (dry runs) nothing is ever written. */
+    RunJournal(const std::filesystem::path& output_dir, bool resume, bool record = true);
+
+    bool is_done(const std::string& kind, const std::string& name, const std::string& fingerprint) const;
+    /** Records completed work and flushes it to disk before returning. */
+    void mark_done(const std::string& kind, const std::string& name, const std::string& fingerprint);
+
+    const std::filesystem::path& path() const { return path_; }
+
+private:
+    std::filesystem::path path_;
+    bool resume_;
+    bool record_;
+    std::map<std::pair<std::string, std::string>, std::string> done_;
+    std::ofstream out_;
+    mutable std::mutex mutex_;
+};
+
+/** Hash of the relative paths and contents of all regular files below dir (empty tree if missing). */
+std::string fingerprint_tree(const std::filesystem::path& dir);
+
+}  // namespace scaffolder
@@ -0,0 +1,116 @@
+#include "util/thread_pool.hpp"
+
+namespace scaffolder {
+
+namespace {
+
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local std::size_t current_worker = 0;
+
+}  // namespace
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = 1;
+    for (unsigned i = 0; i < threads; ++i) queues_.push_back(std::make_unique<WorkQueue>());
+    workers_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        workers_.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto& w : workers_) w.join();
+}
+
+unsigned ThreadPool::resolve_jobs(unsigned jobs) {
+    if (jobs != 0) return jobs;
+    unsigned hw = std::thread::hardware_concurrency();
+    return hw == 0 ? 1 : hw;
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    std::size_t target = current_pool == this ? current_worker : next_queue_++ % queues_.size();
+    pending_.fetch_add(1);
+    {
+        // Counted under the queue lock, before the task is visible, so a worker that pops it at once
+        // cannot decrement queued_ below zero.
+        std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+        queued_.fetch_add(1);
+        queues_[target]->tasks.push_back(std::move(task));
+    }
+    {
+        // Pairs with the predicate check in worker_loop so a worker about to sleep sees the task.
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+    work_cv_.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return pending_.load() == 0; });
+    if (error_) {
+        std::exception_ptr e = error_;
+        error_ = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+bool ThreadPool::try_pop(std::size_t self, std::function<void()>& task) {
+    {
+        WorkQueue& own = *queues_[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued_.fetch_sub(1);
+            return true;
+        }
+    }
+    for (std::size_t i = 1; i < queues_.size(); ++i) {
+        WorkQueue& victim = *queues_[(self + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued_.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run_task(std::function<void()>& task) {
+    try {
+        task();
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) error_ = std::current_exception();
+    }
+    task = nullptr;
+    if (pending_.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_cv_.notify_all();
+    }
+}
+
+void ThreadPool::worker_loop(std::size_t index) {
+    current_pool = this;
+    current_worker = index;
+    for (;;) {
+        std::function<void()> task;
+        if (try_pop(index, task)) {
+            run_task(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        work_cv_.wait(lock, [this] { return stopping_ || queued_.load() > 0; });
+        if (stopping_ && queued_.load() == 0) return;
+    }
+}
+
+}  // namespace scaffolder
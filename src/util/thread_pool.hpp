@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace scaffolder {
+
+/** Fixed-size work-stealing pool. Each worker owns a deque: tasks submitted from a worker go to its
+ *  own deque (run LIFO), idle workers steal the oldest tasks of others. wait() returns once every
+ *  task, including tasks submitted by running tasks, has finished. */
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    /** Blocks until all tasks finished. Rethrows the first exception thrown by a task. */
+    void wait();
+
+    unsigned size() const { return static_cast<unsigned>(workers_.size()); }
+
+    /** Maps a --jobs value to a worker count: 0 means one worker per hardware thread. */
+    static unsigned resolve_jobs(unsigned jobs);
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool try_pop(std::size_t self, std::function<void()>& task);
+    void run_task(std::function<void()>& task);
+    void worker_loop(std::size_t index);
+
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<std::size_t> next_queue_{0};
+    std::atomic<std::size_t> queued_{0};
+    std::atomic<std::size_t> pending_{0};
+    std::mutex mutex_;  // guards sleeping, stopping_ and error_
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    bool stopping_ = false;
+    std::exception_ptr error_;
+};
+
+}  // namespace scaffolder
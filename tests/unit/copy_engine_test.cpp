@@ -0,0 +1,388 @@
+#include <gtest/gtest.h>
+#include "copy/copy_engine.hpp"
+#include "resolver/path_resolver.hpp"
+#include "metadata/schema.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+static void write_file(const fs::path& p, const std::string& content) {
+    fs::create_directories(p.parent_path());
+    std::ofstream f(p, std::ios::binary);
+    f << content;
+}
+
+static std::map<std::string, std::string> snapshot(const fs::path& root) {
+    std::map<std::string, std::string> files;
+    for (const auto& e : fs::recursive_directory_iterator(root)) {
+        if (!e.is_regular_file()) continue;
+        std::ifstream f(e.path(), std::ios::binary);
+        std::stringstream ss;
+        ss << f.rdbuf();
+        files[fs::relative(e.path(), root).generic_string()] = ss.str();
+    }
+    return files;
+}
+
+static scaffolder::SwComponent make_library(const std::string& id, const std::string& source, const std::string& dest) {
+    scaffolder::SwComponent c;
+    c.id = id;
+    c.type = "library";
+    c.source = source;
+    c.dest = dest;
+    return c;
+}
+
+class CopyEngineTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tmp_ = fs::temp_directory_path() / "cmakegen_copy_engine_test";
+        fs::remove_all(tmp_);
+        write_file(tmp_ / "src/hal/hal.c", "hal");
+        write_file(tmp_ / "src/hal/include/hal.h", "hal.h");
+        write_file(tmp_ / "src/hal/docs/readme.txt", "skip");
+        write_file(tmp_ / "src/uart/uart.c", "uart");
+        write_file(tmp_ / "src/uart/sub/uart_impl.c", "uart impl");
+        write_file(tmp_ / "src/uart_override/uart.c", "uart override");
+        write_file(tmp_ / "src/app/main.c", "main");
+
+        components_.push_back(make_library("hal", "src/hal", "platform/drivers/hal"));
+        components_.push_back(make_library("uart", "src/uart", "platform/drivers/uart"));
+        components_.push_back(make_library("app", "src/app", "apps/main"));
+        // Nested in "uart": overwrites uart.c, so ordering must match the serial run.
+        components_.push_back(make_library("uart_override", "src/uart_override", "platform/drivers/uart"));
+        scaffolder::SwComponent ext;
+        ext.id = "ext";
+        ext.type = "external";
+        ext.conan_ref = "zlib/1.3";
+        components_.push_back(ext);
+    }
+
+    void TearDown() override { fs::remove_all(tmp_); }
+
+    fs::path tmp_;
+    std::vector<scaffolder::SwComponent> components_;
+};
+
+TEST_F(CopyEngineTest, SerialCopyAppliesExtensions) {
+    scaffolder::PathResolver resolver(tmp_);
+    fs::path out = tmp_ / "out_serial";
+    scaffolder::CopyEngine engine(resolver, out);
+    engine.copy_components(components_);
+
+    auto files = snapshot(out);
+    EXPECT_EQ(files["platform/drivers/hal/hal.c"], "hal");
+    EXPECT_EQ(files["platform/drivers/hal/include/hal.h"], "hal.h");
+    EXPECT_EQ(files.count("platform/drivers/hal/docs/readme.txt"), 0u);
+    EXPECT_EQ(files["platform/drivers/uart/uart.c"], "uart override");
+    EXPECT_EQ(files["platform/drivers/uart/sub/uart_impl.c"], "uart impl");
+    EXPECT_EQ(files["apps/main/main.c"], "main");
+}
+
+TEST_F(CopyEngineTest, ParallelCopyMatchesSerial) {
+    scaffolder::PathResolver resolver(tmp_);
+    fs::path serial_out = tmp_ / "out_serial";
+    fs::path parallel_out = tmp_ / "out_parallel";
+
+    scaffolder::CopyEngine serial(resolver, serial_out);
+    serial.copy_components(components_);
+    scaffolder::CopyOptions options;
+    options.jobs = 4;
+    scaffolder::CopyEngine parallel(resolver, parallel_out, options);
+    parallel.copy_components(components_);
+
+    EXPECT_EQ(snapshot(serial_out), snapshot(parallel_out));
+}
+
+TEST_F(CopyEngineTest, ParallelCopyOfLargeComponentMatchesSerial) {
+    for (int d = 0; d < 8; ++d) {
+        for (int f = 0; f < 12; ++f) {
+            std::string name = "d" + std::to_string(d) + "/s" + std::to_string(f % 3) + "/f" + std::to_string(f);
+            write_file(tmp_ / "src/big" / (name + ".c"), name);
+            write_file(tmp_ / "src/big" / (name + ".txt"), name);
+        }
+    }
+    std::vector<scaffolder::SwComponent> comps;
+    auto big = make_library("big", "src/big", "big");
+    big.structure = "hierarchical";
+    big.filters = scaffolder::PathFilters{};
+    big.filters->exclude_paths.push_back("d3");
+    comps.push_back(big);
+
+    scaffolder::SwComponent variant;
+    variant.id = "big_variant";
+    variant.type = "variant";
+    variant.source = "src/big";
+    variant.dest = "variant";
+    comps.push_back(variant);
+
+    scaffolder::PathResolver resolver(tmp_);
+    scaffolder::CopyEngine serial(resolver, tmp_ / "out_serial");
+    serial.copy_components(comps);
+    scaffolder::CopyOptions options;
+    options.jobs = 3;
+    scaffolder::CopyEngine parallel(resolver, tmp_ / "out_parallel", options);
+    parallel.copy_components(comps);
+
+    auto files = snapshot(tmp_ / "out_serial");
+    EXPECT_EQ(files.count("big/d0/s0/f0.c"), 1u);
+    EXPECT_EQ(files.count("big/d0/s0/f0.txt"), 0u);
+    EXPECT_EQ(files.count("big/d3/s0/f0.c"), 0u);
+    EXPECT_EQ(files.count("variant/d3/s0/f0.txt"), 1u);
+    EXPECT_EQ(files, snapshot(tmp_ / "out_parallel"));
+}
+
+TEST_F(CopyEngineTest, IncrementalCopySkipsUnchangedFiles) {
+    scaffolder::PathResolver resolver(tmp_);
+    fs::path out = tmp_ / "out_incremental";
+    std::vector<scaffolder::SwComponent> comps{components_[0]};
+    scaffolder::CopyOptions options;
+    options.incremental = true;
+
+    scaffolder::CopyEngine first(resolver, out, options);
+    first.copy_components(comps);
+    EXPECT_EQ(first.stats().copied, 2u);
+    fs::path hal_c = out / "platform/drivers/hal/hal.c";
+    EXPECT_EQ(fs::last_write_time(hal_c), fs::last_write_time(tmp_ / "src/hal/hal.c"));
+
+    scaffolder::CopyEngine second(resolver, out, options);
+    second.copy_components(comps);
+    EXPECT_EQ(second.stats().copied, 0u);
+    EXPECT_EQ(second.stats().unchanged, 2u);
+
+    write_file(tmp_ / "src/hal/hal.c", "hal v2");
+    scaffolder::CopyEngine third(resolver, out, options);
+    third.copy_components(comps);
+    EXPECT_EQ(third.stats().copied, 1u);
+    EXPECT_EQ(snapshot(out)["platform/drivers/hal/hal.c"], "hal v2");
+}
+
+TEST_F(CopyEngineTest, IncrementalContentCompareKeepsDestinationMtime) {
+    scaffolder::PathResolver resolver(tmp_);
+    fs::path out = tmp_ / "out_content";
+    std::vector<scaffolder::SwComponent> comps{components_[0]};
+    scaffolder::CopyOptions options;
+    options.incremental = true;
+    options.compare = scaffolder::CompareMode::Content;
+
+    scaffolder::CopyEngine first(resolver, out, options);
+    first.copy_components(comps);
+    fs::path hal_c = out / "platform/drivers/hal/hal.c";
+    auto old_time = fs::last_write_time(hal_c) - std::chrono::hours(1);
+    fs::last_write_time(hal_c, old_time);
+
+    scaffolder::CopyEngine second(resolver, out, options);
+    second.copy_components(comps);
+    EXPECT_EQ(second.stats().unchanged, 2u);
+    EXPECT_EQ(fs::last_write_time(hal_c), old_time);
+}
+
+TEST_F(CopyEngineTest, MaterializeModes) {
+    scaffolder::PathResolver resolver(tmp_);
+    std::vector<scaffolder::SwComponent> comps{components_[0]};
+    fs::path out = tmp_ / "out_links";
+    fs::path hal_c = out / "platform/drivers/hal/hal.c";
+
+    scaffolder::CopyOptions options;
+    options.materialize = scaffolder::Materialize::Hardlink;
+    scaffolder::CopyEngine hardlink(resolver, out, options);
+    hardlink.copy_components(comps);
+    EXPECT_TRUE(fs::equivalent(hal_c, tmp_ / "src/hal/hal.c"));
+
+    options.materialize = scaffolder::Materialize::Symlink;
+    scaffolder::CopyEngine symlink(resolver, out, options);
+    symlink.copy_components(comps);
+    EXPECT_TRUE(fs::is_symlink(hal_c));
+    EXPECT_EQ(fs::read_symlink(hal_c), fs::absolute(tmp_ / "src/hal/hal.c"));
+
+    // Reflink falls back to a byte copy where the filesystem has no FICLONE support.
+    options.materialize = scaffolder::Materialize::Reflink;
+    scaffolder::CopyEngine reflink(resolver, out, options);
+    reflink.copy_components(comps);
+    EXPECT_FALSE(fs::is_symlink(hal_c));
+    EXPECT_FALSE(fs::equivalent(hal_c, tmp_ / "src/hal/hal.c"));
+    EXPECT_EQ(snapshot(out)["platform/drivers/hal/hal.c"], "hal");
+}
+
+TEST_F(CopyEngineTest, CopyAfterHardlinkDoesNotWriteThroughToSource) {
+    scaffolder::PathResolver resolver(tmp_);
+    std::vector<scaffolder::SwComponent> comps{components_[0]};
+    fs::path out = tmp_ / "out_relink";
+    fs::path hal_c = out / "platform/drivers/hal/hal.c";
+
+    scaffolder::CopyOptions options;
+    options.materialize = scaffolder::Materialize::Hardlink;
+    scaffolder::CopyEngine hardlink(resolver, out, options);
+    hardlink.copy_components(comps);
+
+    options.materialize = scaffolder::Materialize::Copy;
+    options.incremental = true;
+    scaffolder::CopyEngine copy(resolver, out, options);
+    copy.copy_components(comps);
+    EXPECT_EQ(copy.stats().copied, 2u);
+    EXPECT_FALSE(fs::equivalent(hal_c, tmp_ / "src/hal/hal.c"));
+    EXPECT_EQ(snapshot(tmp_ / "src/hal")["hal.c"], "hal");
+}
+
+TEST_F(CopyEngineTest, CopyBackendsProduceIdenticalOutput) {
+    // Larger than one io_uring slot, so it takes the copy_file_range path of that backend.
+    write_file(tmp_ / "src/hal/big.c", std::string(200 * 1024, 'x'));
+    write_file(tmp_ / "src/hal/empty.h", "");
+    fs::permissions(tmp_ / "src/hal/hal.c", fs::perms::owner_all | fs::perms::group_read);
+    scaffolder::PathResolver resolver(tmp_);
+
+    scaffolder::CopyEngine portable(resolver, tmp_ / "out_portable");
+    portable.copy_components(components_);
+    auto expected = snapshot(tmp_ / "out_portable");
+
+    for (auto kind : {scaffolder::CopyBackendKind::CopyFileRange, scaffolder::CopyBackendKind::IoUring}) {
+        fs::path out = tmp_ / ("out_backend_" + std::to_string(static_cast<int>(kind)));
+        scaffolder::CopyOptions options;
+        options.backend = kind;
+        options.jobs = 2;
+        for (int run = 0; run < 2; ++run) {  // second run overwrites existing files
+            scaffolder::CopyEngine engine(resolver, out, options);
+            engine.copy_components(components_);
+            EXPECT_EQ(snapshot(out), expected);
+            EXPECT_EQ(fs::status(out / "platform/drivers/hal/hal.c").permissions(),
+                      fs::status(tmp_ / "src/hal/hal.c").permissions());
+        }
+    }
+}
+
+TEST_F(CopyEngineTest, WalkFollowsFileLinksButNotDirectoryLinks) {
+    fs::create_directory_symlink(tmp_ / "src/uart", tmp_ / "src/hal/uart_link");
+    fs::create_symlink(tmp_ / "src/uart/uart.c", tmp_ / "src/hal/linked.c");
+    scaffolder::PathResolver resolver(tmp_);
+    std::vector<scaffolder::SwComponent> comps{components_[0]};
+
+    for (unsigned jobs : {1u, 3u}) {
+        fs::path out = tmp_ / ("out_links_" + std::to_string(jobs));
+        scaffolder::CopyOptions options;
+        options.jobs = jobs;
+        scaffolder::CopyEngine engine(resolver, out, options);
+        engine.copy_components(comps);
+        auto files = snapshot(out);
+        EXPECT_EQ(files["platform/drivers/hal/linked.c"], "uart");
+        EXPECT_FALSE(fs::is_symlink(out / "platform/drivers/hal/linked.c"));
+        EXPECT_FALSE(fs::exists(out / "platform/drivers/hal/uart_link"));
+        EXPECT_EQ(files.size(), 3u);
+    }
+}
+
+TEST_F(CopyEngineTest, PlanDescribesRunWithoutWriting) {
+    scaffolder::PathResolver resolver(tmp_);
+    fs::path out = tmp_ / "out_plan";
+    scaffolder::CopyOptions options;
+    options.incremental = true;
+    scaffolder::CopyEngine engine(resolver, out, options);
+
+    scaffolder::CopyPlan plan = engine.plan(components_);
+    EXPECT_FALSE(fs::exists(out));
+    std::map<std::string, std::pair<std::string, scaffolder::PlanReason>> by_dest;
+    for (const auto& e : plan.entries()) {
+        std::string dest = fs::relative(plan.destination(e), out).generic_string();
+        EXPECT_EQ(by_dest.count(dest), 0u) << dest;
+        by_dest[dest] = {fs::relative(plan.source(e), tmp_).generic_string(), e.reason};
+    }
+    EXPECT_EQ(by_dest.size(), 5u);
+    // uart and uart_override both provide uart.c; the later component wins, as in a serial copy.
+    EXPECT_EQ(by_dest["platform/drivers/uart/uart.c"].first, "src/uart_override/uart.c");
+    EXPECT_EQ(by_dest["apps/main/main.c"].second, scaffolder::PlanReason::New);
+    EXPECT_EQ(plan.summary().files, 5u);
+    EXPECT_EQ(plan.summary().bytes, 3u + 5u + 13u + 9u + 4u);
+
+    engine.execute(plan);
+    EXPECT_EQ(snapshot(out)["platform/drivers/uart/uart.c"], "uart override");
+    write_file(tmp_ / "src/app/main.c", "main v2");
+    scaffolder::CopyPlan second = engine.plan(components_);
+    EXPECT_EQ(second.summary().files, 1u);
+    EXPECT_EQ(second.summary().unchanged, 4u);
+
+    std::ostringstream json;
+    second.write_json(json);
+    EXPECT_NE(json.str().find("\"reason\": \"changed\""), std::string::npos);
+    EXPECT_NE(json.str().find("\"reason\": \"unchanged\""), std::string::npos);
+}
+
+TEST_F(CopyEngineTest, ExecuteReportsCompletedComponentsForResume) {
+    scaffolder::PathResolver resolver(tmp_);
+    fs::path out = tmp_ / "out_resume";
+    scaffolder::CopyOptions options;
+    options.jobs = 2;
+    scaffolder::CopyEngine engine(resolver, out, options);
+
+    scaffolder::CopyPlan plan = engine.plan(components_);
+    std::vector<std::string> fingerprints;
+    for (uint32_t r = 0; r < plan.roots().size(); ++r) fingerprints.push_back(plan.fingerprint(r));
+    std::mutex mutex;
+    std::vector<std::string> done;
+    engine.execute(plan, [&](uint32_t root) {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.push_back(plan.roots()[root].component);
+    });
+    std::sort(done.begin(), done.end());
+    EXPECT_EQ(done, (std::vector<std::string>{"app", "hal", "uart", "uart_override"}));
+
+    scaffolder::CopyPlan again = engine.plan(components_);
+    for (uint32_t r = 0; r < again.roots().size(); ++r) {
+        EXPECT_EQ(again.fingerprint(r), fingerprints[r]);
+        EXPECT_TRUE(again.outputs_present(r));
+    }
+    again.drop_root(0);
+    EXPECT_EQ(again.entries().size(), plan.entries().size() - 2);
+
+    write_file(tmp_ / "src/hal/new.c", "new");
+    EXPECT_NE(engine.plan(components_).fingerprint(0), fingerprints[0]);
+    fs::remove(out / "apps/main/main.c");
+    EXPECT_FALSE(engine.plan(components_).outputs_present(2));
+}
+
+TEST_F(CopyEngineTest, StagedSourcesAreMovedIntoPlace) {
+    scaffolder::PathResolver resolver(tmp_);
+    fs::path out = tmp_ / "out_staged";
+    std::vector<scaffolder::SwComponent> comps{components_[0]};
+    scaffolder::CopyOptions options;
+    options.incremental = true;
+    options.staged = {"hal"};
+
+    scaffolder::CopyEngine first(resolver, out, options);
+    first.copy_components(comps);
+    EXPECT_EQ(first.stats().moved, 2u);
+    EXPECT_EQ(first.stats().copied, 0u);
+    EXPECT_EQ(snapshot(out)["platform/drivers/hal/hal.c"], "hal");
+    EXPECT_FALSE(fs::exists(tmp_ / "src/hal/hal.c"));
+    EXPECT_TRUE(fs::exists(tmp_ / "src/hal/docs/readme.txt"));
+
+    // A restaged tree has fresh mtimes; unchanged content is still recognised and left in place.
+    write_file(tmp_ / "src/hal/hal.c", "hal");
+    write_file(tmp_ / "src/hal/include/hal.h", "hal.h v2");
+    scaffolder::CopyEngine second(resolver, out, options);
+    second.copy_components(comps);
+    EXPECT_EQ(second.stats().unchanged, 1u);
+    EXPECT_EQ(second.stats().moved, 1u);
+    EXPECT_EQ(snapshot(out)["platform/drivers/hal/include/hal.h"], "hal.h v2");
+}
+
+TEST(SparseCheckoutPatternsTest, CoverSelectedExtensionsAndPlainExcludes) {
+    scaffolder::SwComponent lib = make_library("lib", "src", "out");
+    lib.metadata_extensions = std::vector<std::string>{"cmake"};
+    lib.filters = scaffolder::PathFilters{{"tests", "build/*"}, {"drivers"}, scaffolder::FilterMode::IncludeFirst};
+    std::vector<std::string> expected = {"*.c", "*.cc", "*.cmake", "*.cpp", "*.h", "*.hpp", "!*tests*", "!**/*tests*/**"};
+    EXPECT_EQ(scaffolder::sparse_checkout_patterns(lib), expected);
+
+    // An include pattern can rescue excluded paths, so nothing is excluded up front.
+    lib.filters->filter_mode = scaffolder::FilterMode::ExcludeFirst;
+    EXPECT_EQ(scaffolder::sparse_checkout_patterns(lib).size(), 6u);
+
+    // Variants copy any file: without an exclude to apply the whole tree is needed.
+    scaffolder::SwComponent variant = make_library("v", "src", "out");
+    variant.type = "variant";
+    EXPECT_TRUE(scaffolder::sparse_checkout_patterns(variant).empty());
+}
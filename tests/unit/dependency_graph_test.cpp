@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include "metadata/metadata_index.hpp"
+#include <string>
+#include <vector>
+
+static scaffolder::SwComponent component(const std::string& id, std::vector<std::string> deps) {
+    scaffolder::SwComponent c;
+    c.id = id;
+    c.type = "library";
+    c.dependencies = std::move(deps);
+    return c;
+}
+
+static scaffolder::BuildVariant variant(const std::string& id, const std::string& inherits = "") {
+    scaffolder::BuildVariant bv;
+    bv.id = id;
+    if (!inherits.empty()) bv.inherits = inherits;
+    return bv;
+}
+
+template <typename T>
+static std::vector<std::string> ids(const std::vector<const T*>& items) {
+    std::vector<std::string> result;
+    for (const T* item : items) result.push_back(item->id);
+    return result;
+}
+
+TEST(DependencyGraphTest, OrdersComponentsAfterTheirDependencies) {
+    scaffolder::Metadata meta;
+    meta.source_tree.components = {component("app", {"drv", "util"}), component("drv", {"hal", "fmt"}),
+                                   component("util", {}), component("hal", {"util"})};
+    scaffolder::MetadataIndex index(meta);
+    const auto& graph = index.graph();
+    EXPECT_EQ(ids(graph.component_order()), (std::vector<std::string>{"util", "hal", "drv", "app"}));
+    EXPECT_TRUE(graph.component_cycles().empty());
+}
+
+TEST(DependencyGraphTest, ReportsEveryCycleInOnePass) {
+    scaffolder::Metadata meta;
+    meta.source_tree.components = {component("a", {"b"}), component("b", {"c"}), component("c", {"a", "d"}),
+                                   component("d", {}), component("e", {"e"}), component("f", {"a"})};
+    scaffolder::MetadataIndex index(meta);
+    const auto& graph = index.graph();
+    ASSERT_EQ(graph.component_cycles().size(), 2u);
+    EXPECT_EQ(ids(graph.component_cycles()[0]), (std::vector<std::string>{"a", "b", "c"}));
+    EXPECT_EQ(ids(graph.component_cycles()[1]), (std::vector<std::string>{"e"}));
+    EXPECT_EQ(ids(graph.component_order()), (std::vector<std::string>{"d", "a", "b", "c", "e", "f"}));
+}
+
+TEST(DependencyGraphTest, HandlesInheritanceAndLongChains) {
+    scaffolder::Metadata meta;
+    meta.build_variants = {variant("release", "base"), variant("base"), variant("x", "y"), variant("y", "x"),
+                           variant("z", "missing")};
+    for (int i = 0; i < 20000; ++i) {
+        meta.source_tree.components.push_back(component("c" + std::to_string(i), {"c" + std::to_string(i + 1)}));
+    }
+    scaffolder::MetadataIndex index(meta);
+    const auto& graph = index.graph();
+    EXPECT_EQ(ids(graph.build_variant_order()), (std::vector<std::string>{"base", "release", "x", "y", "z"}));
+    ASSERT_EQ(graph.inheritance_cycles().size(), 1u);
+    EXPECT_EQ(ids(graph.inheritance_cycles()[0]), (std::vector<std::string>{"x", "y"}));
+
+    EXPECT_TRUE(graph.component_cycles().empty());
+    EXPECT_EQ(graph.component_order().front()->id, "c19999");
+    EXPECT_EQ(graph.component_order().back()->id, "c0");
+}
@@ -2,13 +2,13 @@
 #include "copy/filter.hpp"
 #include "metadata/schema.hpp"
 #include <filesystem>
+#include <regex>
 
 TEST(FilterTest, MatchesExtension) {
-    scaffolder::PathFilters pf;
-    scaffolder::Filter filter(pf);
-    EXPECT_TRUE(filter.matches_extension(std::filesystem::path("foo.c"), {"*.c", "*.cpp"}));
-    EXPECT_TRUE(filter.matches_extension(std::filesystem::path("foo.cpp"), {"*.c", "*.cpp"}));
-    EXPECT_FALSE(filter.matches_extension(std::filesystem::path("foo.c"), {"*.h"}));
+    scaffolder::ExtensionSet sources({"*.c", "*.cpp"});
+    EXPECT_TRUE(sources.matches(std::filesystem::path("foo.c")));
+    EXPECT_TRUE(sources.matches(std::filesystem::path("foo.cpp")));
+    EXPECT_FALSE(scaffolder::ExtensionSet({"*.h"}).matches(std::filesystem::path("foo.c")));
 }
 
 TEST(FilterTest, ShouldIncludeEmptyFilters) {
@@ -61,3 +61,77 @@ TEST(FilterTest, ExcludeFirst_NoExclude_AllIncluded) {
     EXPECT_TRUE(filter.should_include(std::filesystem::path("/a/src/foo.c"), base));
     EXPECT_TRUE(filter.should_include(std::filesystem::path("/a/doc/readme.txt"), base));
 }
+
+TEST(FilterTest, PrunesDirectoryOnlyWhenNoDescendantCanMatch) {
+    scaffolder::PathFilters pf;
+    pf.include_paths.push_back("src");
+    pf.exclude_paths.push_back("test");
+    pf.exclude_paths.push_back("legacy/**");
+    pf.exclude_paths.push_back("*.bak");
+    scaffolder::Filter filter(pf);
+    std::filesystem::path base("/a");
+    EXPECT_TRUE(filter.prunes_directory(std::filesystem::path("/a/src/test"), base));
+    EXPECT_TRUE(filter.prunes_directory(std::filesystem::path("/a/unittest/x"), base));
+    EXPECT_TRUE(filter.prunes_directory(std::filesystem::path("/a/legacy"), base));
+    EXPECT_TRUE(filter.prunes_directory(std::filesystem::path("/a/legacy/old"), base));
+    EXPECT_FALSE(filter.prunes_directory(std::filesystem::path("/a/src"), base));
+    EXPECT_FALSE(filter.prunes_directory(std::filesystem::path("/a/legacy_api"), base));
+    EXPECT_FALSE(filter.prunes_directory(std::filesystem::path("/a/src/old.bak.d"), base));
+    EXPECT_FALSE(filter.prunes_directory(base, base));
+}
+
+TEST(FilterTest, ExcludeFirst_NeverPrunes) {
+    scaffolder::PathFilters pf;
+    pf.filter_mode = scaffolder::FilterMode::ExcludeFirst;
+    pf.exclude_paths.push_back("test");
+    pf.include_paths.push_back("special");
+    scaffolder::Filter filter(pf);
+    std::filesystem::path base("/a");
+    EXPECT_FALSE(filter.prunes_directory(std::filesystem::path("/a/test"), base));
+    EXPECT_TRUE(filter.should_include(std::filesystem::path("/a/test/special/x.c"), base));
+}
+
+TEST(FilterTest, GlobPatternMatchesLikeTranslatedRegex) {
+    // Reference: the glob-to-regex translation the matcher replaces.
+    auto reference = [](const std::string& pat, const std::string& path) {
+        std::string re;
+        for (size_t i = 0; i < pat.size(); ++i) {
+            if (pat[i] == '*' && i + 1 < pat.size() && pat[i + 1] == '*') {
+                re += ".*";
+                ++i;
+            } else if (pat[i] == '*') {
+                re += "[^/]*";
+            } else if (pat[i] == '?') {
+                re += "[^/]";
+            } else if (pat[i] == '.') {
+                re += "\\.";
+            } else {
+                re += pat[i];
+            }
+        }
+        return std::regex_match(path, std::regex(re));
+    };
+    std::vector<std::string> patterns{"", "src", "*.c", "src/*.c", "src/**", "**/test/**", "**.h", "a?c",
+                                      "***", "src/*/x*y", "**/*.cpp", "[ab]/*.c", "(src|lib)/**"};
+    std::vector<std::string> paths{"", "src", "main.c", "src/main.c", "src/a/main.c", "lib/test/x.c",
+                                   "test/x", "inc/a.h", "abc", "a/c", "src/d/xay", "src/d/e/xy",
+                                   "a/b.cpp", "b/x.c", "lib/z"};
+    for (const auto& pat : patterns) {
+        scaffolder::GlobPattern glob(pat);
+        for (const auto& path : paths) {
+            EXPECT_EQ(glob.matches(path), reference(pat, path)) << pat << " vs " << path;
+        }
+    }
+    EXPECT_TRUE(scaffolder::GlobPattern("src\\*.c").matches("src/main.c"));
+}
+
+TEST(FilterTest, ExtensionSetAcceptsAllSpellings) {
+    scaffolder::ExtensionSet set({"*.c", ".h", "hpp", "", "*.tar.gz"});
+    EXPECT_TRUE(set.matches(std::filesystem::path("dir/a.c")));
+    EXPECT_TRUE(set.matches(std::filesystem::path("a.h")));
+    EXPECT_TRUE(set.matches(std::filesystem::path("a.hpp")));
+    EXPECT_FALSE(set.matches(std::filesystem::path("a.cc")));
+    EXPECT_FALSE(set.matches(std::filesystem::path("a.tar.gz")));
+    EXPECT_FALSE(set.matches(std::filesystem::path("Makefile")));
+    EXPECT_FALSE(set.matches(std::filesystem::path(".c")));
+}
@@ -0,0 +1,245 @@
+#include <gtest/gtest.h>
+#include "resolver/git_cache.hpp"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static void write_file(const fs::path& p, const std::string& content) {
+    fs::create_directories(p.parent_path());
+    std::ofstream f(p, std::ios::binary);
+    f << content;
+}
+
+static std::string read_file(const fs::path& p) {
+    std::ifstream f(p, std::ios::binary);
+    std::stringstream ss;
+    ss << f.rdbuf();
+    return ss.str();
+}
+
+static void git(const fs::path& repo, const std::string& args) {
+    std::string cmd = "git -C \"" + repo.string() + "\" -c user.name=test -c user.email=test@example.com " + args;
+    ASSERT_EQ(std::system(cmd.c_str()), 0) << cmd;
+}
+
+class GitCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        tmp_ = fs::temp_directory_path() / "cmakegen_git_cache_test";
+        fs::remove_all(tmp_);
+        fs::create_directories(tmp_ / "work");
+        git(tmp_ / "work", "init -q -b main");
+        write_file(tmp_ / "work/uart.c", "v1");
+        git(tmp_ / "work", "add uart.c");
+        git(tmp_ / "work", "commit -q -m v1");
+        git(tmp_ / "work", "tag v1");
+        write_file(tmp_ / "work/uart.c", "v2");
+        git(tmp_ / "work", "commit -q -am v2");
+        git(tmp_, "clone -q --bare work origin.git");
+        git(tmp_ / "origin.git", "config uploadpack.allowFilter true");
+        url_ = "file://" + (tmp_ / "origin.git").generic_string();
+    }
+
+    void TearDown() override { fs::remove_all(tmp_); }
+
+    scaffolder::GitSource source(const std::string& kind, const std::string& ref) const {
+        scaffolder::GitSource s;
+        s.url = url_;
+        if (kind == "tag") s.tag = ref;
+        if (kind == "branch") s.branch = ref;
+        if (kind == "commit") s.commit = ref;
+        return s;
+    }
+
+    fs::path tmp_;
+    std::string url_;
+};
+
+TEST_F(GitCacheTest, ChecksOutTagsBranchesAndCommitsFromOneMirror) {
+    scaffolder::GitCache cache(tmp_ / "cache");
+    fs::path tag = cache.checkout(source("tag", "v1"), "uart");
+    fs::path branch = cache.checkout(source("branch", "main"), "uart");
+    EXPECT_EQ(read_file(tag / "uart.c"), "v1");
+    EXPECT_EQ(read_file(branch / "uart.c"), "v2");
+
+    // Worktrees are keyed by commit, so the same commit by another name is the same checkout.
+    fs::path commit = cache.checkout(source("commit", tag.filename().string()), "uart");
+    EXPECT_EQ(commit, tag);
+
+    size_t mirrors = 0;
+    for (const auto& e : fs::directory_iterator(tmp_ / "cache/mirrors")) mirrors += e.is_directory();
+    EXPECT_EQ(mirrors, 1u);
+}
+
+TEST_F(GitCacheTest, FetchesOnlyWhenRefIsMissing) {
+    scaffolder::GitCache cache(tmp_ / "cache");
+    cache.checkout(source("tag", "v1"), "uart");
+
+    // With the remote gone, refs already in the mirror still resolve.
+    fs::rename(tmp_ / "origin.git", tmp_ / "offline.git");
+    EXPECT_EQ(read_file(cache.checkout(source("tag", "v1"), "uart") / "uart.c"), "v1");
+    EXPECT_THROW(cache.checkout(source("tag", "v3"), "uart"), std::runtime_error);
+
+    fs::rename(tmp_ / "offline.git", tmp_ / "origin.git");
+    write_file(tmp_ / "work/uart.c", "v3");
+    git(tmp_ / "work", "commit -q -am v3");
+    git(tmp_ / "work", "tag v3");
+    git(tmp_ / "work", "push -q \"" + (tmp_ / "origin.git").string() + "\" main v3");
+    EXPECT_EQ(read_file(cache.checkout(source("tag", "v3"), "uart") / "uart.c"), "v3");
+}
+
+TEST_F(GitCacheTest, RefreshFetchesBranchesButNotTags) {
+    scaffolder::GitCache(tmp_ / "cache").checkout(source("tag", "v1"), "uart");
+    write_file(tmp_ / "work/uart.c", "v3");
+    git(tmp_ / "work", "commit -q -am v3");
+    git(tmp_ / "work", "push -q \"" + (tmp_ / "origin.git").string() + "\" main");
+
+    // Without a refresh the branch stays where the mirror has it.
+    EXPECT_EQ(read_file(scaffolder::GitCache(tmp_ / "cache").checkout(source("branch", "main"), "uart") / "uart.c"), "v2");
+    scaffolder::GitCache refreshing(tmp_ / "cache", true);
+    EXPECT_EQ(read_file(refreshing.checkout(source("branch", "main"), "uart") / "uart.c"), "v3");
+
+    // A tag in the mirror is used as it is; a branch refresh needs the remote.
+    fs::rename(tmp_ / "origin.git", tmp_ / "offline.git");
+    EXPECT_EQ(read_file(scaffolder::GitCache(tmp_ / "cache", true).checkout(source("tag", "v1"), "uart") / "uart.c"), "v1");
+    EXPECT_THROW(scaffolder::GitCache(tmp_ / "cache", true).checkout(source("branch", "main"), "uart"), std::runtime_error);
+}
+
+TEST_F(GitCacheTest, ConcurrentRunsShareOneWorktree) {
+    scaffolder::GitCache(tmp_ / "cache").checkout(source("tag", "v1"), "uart");
+    // Separate cache objects do not share locks, like two processes using one cache directory.
+    std::vector<fs::path> trees(4);
+    std::vector<std::string> errors(trees.size());
+    std::vector<std::thread> runs;
+    for (size_t i = 0; i < trees.size(); ++i) {
+        runs.emplace_back([&, i] {
+            try {
+                trees[i] = scaffolder::GitCache(tmp_ / "cache").checkout(source("branch", "main"), "uart");
+            } catch (const std::exception& e) {
+                errors[i] = e.what();
+            }
+        });
+    }
+    for (auto& t : runs) t.join();
+    for (size_t i = 0; i < trees.size(); ++i) {
+        EXPECT_EQ(errors[i], "");
+        EXPECT_EQ(trees[i], trees[0]);
+    }
+    EXPECT_EQ(read_file(trees[0] / "uart.c"), "v2");
+    for (const auto& e : fs::directory_iterator(trees[0].parent_path())) {
+        EXPECT_EQ(e.path().filename().string().find(".tmp-"), std::string::npos) << e.path();
+    }
+}
+
+TEST_F(GitCacheTest, SparseCheckoutHoldsOnlyMatchingFiles) {
+    write_file(tmp_ / "work/tests/uart_test.c", "t");
+    write_file(tmp_ / "work/docs/uart.md", "d");
+    git(tmp_ / "work", "add tests docs");
+    git(tmp_ / "work", "commit -q -m docs");
+    git(tmp_ / "work", "push -q \"" + (tmp_ / "origin.git").string() + "\" main");
+
+    scaffolder::GitCache cache(tmp_ / "cache");
+    fs::path sparse = cache.checkout(source("branch", "main"), "uart", {"*.c", "!*tests*", "!**/*tests*/**"});
+    EXPECT_TRUE(fs::exists(sparse / "uart.c"));
+    EXPECT_FALSE(fs::exists(sparse / "tests/uart_test.c"));
+    EXPECT_FALSE(fs::exists(sparse / "docs/uart.md"));
+
+    // The patterns belong to that worktree only; a full checkout of the same commit is separate.
+    fs::path full = cache.checkout(source("branch", "main"), "uart");
+    EXPECT_NE(full, sparse);
+    EXPECT_TRUE(fs::exists(full / "tests/uart_test.c"));
+    EXPECT_TRUE(fs::exists(full / "docs/uart.md"));
+}
+
+TEST_F(GitCacheTest, PinnedCommitIsFetchedWithoutHistory) {
+    git(tmp_ / "origin.git", "rev-parse main >\"" + (tmp_ / "head").string() + "\"");
+    std::string head = read_file(tmp_ / "head");
+    head.erase(head.find_last_not_of('\n') + 1);
+
+    scaffolder::GitCache cache(tmp_ / "cache");
+    fs::path tree = cache.checkout(source("commit", head), "uart");
+    EXPECT_EQ(read_file(tree / "uart.c"), "v2");
+    fs::path mirror;
+    for (const auto& e : fs::directory_iterator(tmp_ / "cache/mirrors")) {
+        if (e.is_directory()) mirror = e.path();
+    }
+    EXPECT_EQ(read_file(mirror / "shallow"), head + "\n");
+
+    // Named refs are fetched on demand into the same mirror.
+    EXPECT_EQ(read_file(cache.checkout(source("tag", "v1"), "uart") / "uart.c"), "v1");
+}
+
+TEST_F(GitCacheTest, StageWritesSelectedFilesWithoutWorktree) {
+    write_file(tmp_ / "work/tests/uart_test.c", "t");
+    write_file(tmp_ / "work/docs/uart.md", "d");
+    git(tmp_ / "work", "add tests docs");
+    git(tmp_ / "work", "commit -q -m docs");
+    git(tmp_ / "work", "push -q \"" + (tmp_ / "origin.git").string() + "\" main");
+
+    scaffolder::GitCache cache(tmp_ / "cache");
+    fs::path staged = cache.stage(source("branch", "main"), "uart", {"*.c", "!*tests*", "!**/*tests*/**"}, tmp_ / "out");
+    EXPECT_EQ(staged.parent_path(), tmp_ / "out");
+    EXPECT_EQ(read_file(staged / "uart.c"), "v2");
+    EXPECT_FALSE(fs::exists(staged / "tests/uart_test.c"));
+    EXPECT_FALSE(fs::exists(staged / "docs/uart.md"));
+    EXPECT_FALSE(fs::exists(staged / ".git"));
+    EXPECT_FALSE(fs::exists(tmp_ / "cache/worktrees"));
+    size_t entries = 0;
+    for (const auto& e : fs::directory_iterator(tmp_ / "out")) entries += e.path() != staged;
+    EXPECT_EQ(entries, 0u);
+
+    // No patterns stage the whole commit.
+    fs::path full = cache.stage(source("tag", "v1"), "uart_all", {}, tmp_ / "out");
+    EXPECT_EQ(read_file(full / "uart.c"), "v1");
+}
+
+TEST_F(GitCacheTest, PruneRemovesOnlyStaleEntries) {
+    scaffolder::GitCache cache(tmp_ / "cache");
+    fs::path tree = cache.checkout(source("tag", "v1"), "uart");
+
+    auto kept = cache.prune(std::chrono::hours(24 * 30));
+    EXPECT_EQ(kept.worktrees, 0u);
+    EXPECT_EQ(kept.mirrors, 0u);
+    EXPECT_TRUE(fs::exists(tree / "uart.c"));
+
+    auto removed = cache.prune(std::chrono::hours(0));
+    EXPECT_EQ(removed.worktrees, 1u);
+    EXPECT_EQ(removed.mirrors, 1u);
+    EXPECT_FALSE(fs::exists(tree));
+
+    // A pruned cache is rebuilt on the next checkout.
+    EXPECT_EQ(read_file(cache.checkout(source("tag", "v1"), "uart") / "uart.c"), "v1");
+}
+
+TEST_F(GitCacheTest, CheckoutAllReportsEveryFailureTogether) {
+    scaffolder::GitCache cache(tmp_ / "cache");
+    scaffolder::GitSource missing = source("tag", "v1");
+    missing.url = "file://" + (tmp_ / "missing.git").generic_string();
+    std::vector<scaffolder::GitCache::CheckoutRequest> requests = {
+        {"uart", source("tag", "v1"), {}, {}},
+        {"spi", missing, {}, {}},
+        {"i2c", source("tag", "v9"), {}, {}},
+        {"gpio", source("branch", "main"), {}, {}},
+    };
+    try {
+        cache.checkout_all(requests, 4);
+        FAIL() << "expected checkout_all to throw";
+    } catch (const std::runtime_error& e) {
+        std::string what = e.what();
+        EXPECT_NE(what.find("2 of 4"), std::string::npos) << what;
+        EXPECT_NE(what.find("spi"), std::string::npos) << what;
+        EXPECT_NE(what.find("i2c"), std::string::npos) << what;
+    }
+
+    // The failures did not stop the other checkouts.
+    requests.erase(requests.begin() + 1, requests.begin() + 3);
+    std::vector<fs::path> trees = cache.checkout_all(requests, 4);
+    ASSERT_EQ(trees.size(), 2u);
+    EXPECT_EQ(read_file(trees[0] / "uart.c"), "v1");
+    EXPECT_EQ(read_file(trees[1] / "uart.c"), "v2");
+}
@@ -405,10 +405,11 @@ TEST(MetadataBuilderTest, MinimalBuilderGeneratesFiles) {
 
     scaffolder::PathResolver resolver(tmp);
     scaffolder::CopyEngine copy_engine(resolver, output);
-    scaffolder::CmakeGenerator cmake_gen(meta, resolver, output);
-    scaffolder::ToolchainGenerator toolchain_gen(meta);
-    scaffolder::PresetGenerator preset_gen(meta);
-    scaffolder::ConanGenerator conan_gen(meta);
+    scaffolder::MetadataIndex index(meta);
+    scaffolder::CmakeGenerator cmake_gen(index, resolver, output);
+    scaffolder::ToolchainGenerator toolchain_gen(index);
+    scaffolder::PresetGenerator preset_gen(index);
+    scaffolder::ConanGenerator conan_gen(index);
 
     cmake_gen.generate_all();
     toolchain_gen.generate_all(output);
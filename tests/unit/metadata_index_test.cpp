@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include "metadata/metadata_index.hpp"
+
+static scaffolder::SwComponent component(const std::string& id, const std::string& type) {
+    scaffolder::SwComponent c;
+    c.id = id;
+    c.type = type;
+    return c;
+}
+
+TEST(MetadataIndexTest, FindsEntitiesById) {
+    scaffolder::Metadata meta;
+    meta.socs = {{"h7", "H7", "", {"cortex-m7"}}};
+    meta.boards = {{"nucleo", "Nucleo", {"h7"}, {}}};
+    meta.isa_variants = {{"cortex-m7", "arm", "M7"}};
+    scaffolder::Toolchain arm;
+    arm.id = "arm";
+    meta.toolchains = {arm};
+    scaffolder::BuildVariant debug;
+    debug.id = "debug";
+    meta.build_variants = {debug};
+    meta.source_tree.components = {component("hal", "library"), component("hal", "executable")};
+
+    scaffolder::MetadataIndex index(meta);
+    EXPECT_EQ(index.soc("h7"), &meta.socs[0]);
+    EXPECT_EQ(index.board("nucleo"), &meta.boards[0]);
+    EXPECT_EQ(index.isa_variant("cortex-m7"), &meta.isa_variants[0]);
+    EXPECT_EQ(index.toolchain("arm"), &meta.toolchains[0]);
+    EXPECT_EQ(index.build_variant("debug"), &meta.build_variants[0]);
+    EXPECT_EQ(index.component("hal"), &meta.source_tree.components[0]);  // first of a repeated id
+    EXPECT_EQ(index.component("uart"), nullptr);
+    EXPECT_EQ(index.soc("nucleo"), nullptr);
+}
+
+TEST(MetadataIndexTest, ListsDependentsAndLayerChildrenInOrder) {
+    scaffolder::Metadata meta;
+    auto& comps = meta.source_tree.components;
+    comps.push_back(component("hal", "library"));
+    auto app = component("app", "executable");
+    app.dependencies = std::vector<std::string>{"hal", "fmt"};
+    comps.push_back(app);
+    auto drv = component("drv", "library");
+    drv.dependencies = std::vector<std::string>{"hal"};
+    comps.push_back(drv);
+    auto libs = component("libs", "layer");
+    libs.subdirs = std::vector<std::string>{"drv", "missing", "hal"};
+    comps.push_back(libs);
+
+    scaffolder::MetadataIndex index(meta);
+    ASSERT_EQ(index.dependents("hal").size(), 2u);
+    EXPECT_EQ(index.dependents("hal")[0]->id, "app");
+    EXPECT_EQ(index.dependents("hal")[1]->id, "drv");
+    EXPECT_EQ(index.dependents("fmt").size(), 1u);  // unknown ids still have dependents
+    EXPECT_TRUE(index.dependents("app").empty());
+
+    ASSERT_EQ(index.children("libs").size(), 2u);
+    EXPECT_EQ(index.children("libs")[0]->id, "drv");
+    EXPECT_EQ(index.children("libs")[1]->id, "hal");
+    EXPECT_TRUE(index.children("hal").empty());
+}
@@ -0,0 +1,235 @@
+#include <gtest/gtest.h>
+#include "generator/cmake_generator.hpp"
+#include "generator/embedded_templates.hpp"
+#include "generator/preset_generator.hpp"
+#include "generator/template_engine.hpp"
+#include "generator/toolchain_generator.hpp"
+#include "resolver/path_resolver.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+
+namespace fs = std::filesystem;
+
+// The shared engine reads $CMAKEGEN_TEMPLATES_DIR once. Pointing it at a directory that is filled
+// with copies of the built-in templates, or left empty, switches between inja and the native emitters.
+static fs::path overrides_dir() {
+    static const fs::path dir = [] {
+        fs::path d = fs::temp_directory_path() / "cmakegen_native_emitters_overrides";
+#ifdef _WIN32
+        _putenv_s("CMAKEGEN_TEMPLATES_DIR", d.string().c_str());
+#else
+        setenv("CMAKEGEN_TEMPLATES_DIR", d.string().c_str(), 1);
+#endif
+        return d;
+    }();
+    return dir;
+}
+
+static void write_file(const fs::path& p, const std::string& content) {
+    fs::create_directories(p.parent_path());
+    std::ofstream f(p, std::ios::binary);
+    f << content;
+}
+
+static std::string read_file(const fs::path& p) {
+    std::ifstream f(p, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+static std::map<std::string, std::string> read_tree(const fs::path& dir) {
+    std::map<std::string, std::string> files;
+    for (const auto& e : fs::recursive_directory_iterator(dir)) {
+        if (e.is_regular_file()) files[fs::relative(e.path(), dir).generic_string()] = read_file(e.path());
+    }
+    return files;
+}
+
+static scaffolder::Condition equals(const std::string& var, const std::string& value) {
+    scaffolder::Condition c;
+    c.var = var;
+    c.op = "equals";
+    c.value = value;
+    return c;
+}
+
+static scaffolder::SwComponent component(const std::string& id, const std::string& type, const std::string& dest) {
+    scaffolder::SwComponent c;
+    c.id = id;
+    c.type = type;
+    c.dest = dest;
+    return c;
+}
+
+static scaffolder::Metadata full_metadata() {
+    scaffolder::Metadata meta;
+    meta.project = {"native", "1.2.3", {3, 25, 1}};
+    meta.socs = {{"h7", "H7", "", {"cortex-m7"}}, {"rv", "RV", "", {"rv32"}}};
+    meta.boards = {{"nucleo", "Nucleo", {"h7", "rv"}, {}}};
+    meta.isa_variants = {{"cortex-m7", "arm", "M7"}, {"rv32", "riscv", "RV32"}};
+    meta.preset_matrix.binary_dir_pattern = "build/${preset}";
+
+    scaffolder::Toolchain arm;
+    arm.id = "arm";
+    arm.display_name = "ARM GCC";
+    arm.compiler = {"arm-none-eabi-gcc", "arm-none-eabi-g++", "arm-none-eabi-gcc"};
+    arm.flags = {{"c", {"-mcpu=cortex-m7", "-mthumb"}}, {"cxx", {"-mthumb"}}, {"asm", {"-x", "assembler"}},
+                 {"linker", {"-specs=nano.specs"}}};
+    arm.libs = {"c", "nosys"};
+    arm.lib_paths = {"/opt/arm/lib"};
+    arm.defines = {"ARM", "USE_HAL=1"};
+    arm.sysroot = "/opt/arm";
+    scaffolder::Toolchain riscv;
+    riscv.id = "riscv";
+    riscv.display_name = "RISC-V";
+    riscv.compiler = {"riscv-gcc", "riscv-g++", "riscv-gcc"};
+    riscv.flags = {{"c", {"-march=rv32imac"}}};
+    meta.toolchains = {arm, riscv};
+
+    scaffolder::BuildVariant debug;
+    debug.id = "debug";
+    debug.flags = {{"c", {"-g", "-O0"}}, {"cxx", {"-g"}}};
+    scaffolder::BuildVariant release;
+    release.id = "release";
+    release.flags = {{"c", {"-O2"}}};
+    release.remove_flags = {{"c", {"-mthumb"}}};
+    release.add_flags = {{"riscv", {{"linker", {"-Wl,--gc-sections"}}}}};
+    meta.build_variants = {debug, release};
+
+    auto& comps = meta.source_tree.components;
+    auto hal = component("hal", "library", "libs/hal");
+    hal.dependencies = std::vector<std::string>{"cmsis", "startup"};
+    hal.condition = equals("SOC", "h7");
+    comps.push_back(hal);
+    auto util = component("util", "library", "libs/util");
+    util.library_type = "shared";
+    util.source_extensions = std::vector<std::string>{"*.c"};
+    comps.push_back(util);
+    auto rtos = component("rtos", "library", "libs/rtos");
+    rtos.structure = "hierarchical";
+    rtos.library_type = "interface";
+    rtos.dependencies = std::vector<std::string>{"hal"};
+    rtos.condition = equals("BOARD", "nucleo");
+    comps.push_back(rtos);
+    auto plain = component("plain", "library", "libs/plain");
+    plain.structure = "hierarchical";
+    comps.push_back(plain);
+    auto app = component("app", "executable", "app");
+    app.dependencies = std::vector<std::string>{"hal", "util"};
+    comps.push_back(app);
+    auto tool = component("tool", "executable", "tools/tool");
+    tool.condition = equals("BUILD_VARIANT", "debug");
+    comps.push_back(tool);
+    auto port = component("port", "variant", "port");
+    port.variations = std::vector<scaffolder::Variation>{{"h7", equals("SOC", "h7")}, {"rv", equals("SOC", "rv")}};
+    comps.push_back(port);
+    auto libs = component("libs", "layer", "libs");
+    libs.subdirs = std::vector<std::string>{"hal", "util", "rtos", "plain", "missing"};
+    libs.condition = equals("SOC", "h7");
+    comps.push_back(libs);
+    auto tools = component("tools", "layer", "tools");
+    tools.subdirs = std::vector<std::string>{"tool"};
+    comps.push_back(tools);
+    auto root = component("root_layer", "layer", ".");
+    root.subdirs = std::vector<std::string>{"libs", "app", "tools", "port"};
+    comps.push_back(root);
+    auto fmt = component("fmt", "external", "");
+    fmt.conan_ref = "fmt/10.0.0";
+    comps.push_back(fmt);
+    return meta;
+}
+
+class NativeEmittersTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = fs::temp_directory_path() / "cmakegen_native_emitters_test";
+        fs::remove_all(dir_);
+        fs::remove_all(overrides_dir());
+    }
+
+    void TearDown() override {
+        fs::remove_all(dir_);
+        fs::remove_all(overrides_dir());
+    }
+
+    static void generate(const scaffolder::Metadata& meta, const fs::path& output) {
+        scaffolder::PathResolver resolver(output);
+        scaffolder::MetadataIndex index(meta);
+        scaffolder::CmakeGenerator(index, resolver, output).generate_all();
+        scaffolder::ToolchainGenerator(index).generate_all(output);
+        scaffolder::PresetGenerator(index).generate(output);
+    }
+
+    // Generates meta once through the native emitters and once through inja, which renders the
+    // same built-in templates because they are copied into the override directory. Both runs use
+    // one output directory, since CMakePresets.json holds absolute paths.
+    void expect_same_output(const scaffolder::Metadata& meta) {
+        fs::path output = dir_ / "out";
+        fs::create_directories(overrides_dir());
+        ASSERT_FALSE(scaffolder::TemplateEngine::shared().has_override("library_cmakelists.jinja2"));
+        generate(meta, output);
+        auto native = read_tree(output);
+        fs::remove_all(output);
+
+        for (size_t i = 0; i < scaffolder::kEmbeddedTemplateCount; ++i) {
+            const scaffolder::EmbeddedTemplate& t = scaffolder::kEmbeddedTemplates[i];
+            write_file(overrides_dir() / t.name, std::string(reinterpret_cast<const char*>(t.data), t.size));
+        }
+        ASSERT_TRUE(scaffolder::TemplateEngine::shared().has_override("library_cmakelists.jinja2"));
+        generate(meta, output);
+        auto inja = read_tree(output);
+
+        ASSERT_FALSE(native.empty());
+        for (const auto& [name, content] : inja) {
+            auto it = native.find(name);
+            ASSERT_NE(it, native.end()) << name;
+            EXPECT_EQ(it->second, content) << name;
+        }
+        EXPECT_EQ(native.size(), inja.size());
+    }
+
+    fs::path dir_;
+};
+
+TEST_F(NativeEmittersTest, MatchTemplatesForEveryComponentKind) {
+    expect_same_output(full_metadata());
+}
+
+TEST_F(NativeEmittersTest, MatchTemplatesWithoutBuildVariantsOrRootLayer) {
+    scaffolder::Metadata meta = full_metadata();
+    meta.build_variants.clear();
+    auto& comps = meta.source_tree.components;
+    comps.erase(std::remove_if(comps.begin(), comps.end(), [](const auto& c) { return c.id == "root_layer"; }),
+                comps.end());
+    expect_same_output(meta);
+}
+
+TEST_F(NativeEmittersTest, MatchTemplatesForEmptyMetadata) {
+    scaffolder::Metadata meta;
+    meta.project = {"empty", "0.1", {}};
+    expect_same_output(meta);
+}
+
+TEST_F(NativeEmittersTest, EmptySysrootIsWrittenAsTheTemplateRendersIt) {
+    // inja treats "" as true, so toolchain.jinja2 has always written the sysroot lines.
+    generate(full_metadata(), dir_ / "out");
+    std::string riscv = read_file(dir_ / "out" / "toolchains" / "riscv-debug.cmake");
+    EXPECT_NE(riscv.find("set(CMAKE_SYSROOT \"\")\nset(CMAKE_FIND_ROOT_PATH \"\")\n"), std::string::npos);
+}
+
+TEST_F(NativeEmittersTest, LayersWithoutRootLayerKeepTheirEmptyGuard) {
+    // Without a root_layer the root CMakeLists has always listed every layer with its condition,
+    // an empty one included.
+    scaffolder::Metadata meta = full_metadata();
+    auto& comps = meta.source_tree.components;
+    comps.erase(std::remove_if(comps.begin(), comps.end(), [](const auto& c) { return c.id == "root_layer"; }),
+                comps.end());
+    generate(meta, dir_ / "out");
+    std::string root = read_file(dir_ / "out" / "CMakeLists.txt");
+    EXPECT_NE(root.find("\nif()\n  add_subdirectory(tools)\nendif()\n"), std::string::npos);
+    EXPECT_NE(root.find("\nif(SOC STREQUAL \"h7\")\n  add_subdirectory(libs)\nendif()\n"), std::string::npos);
+}
@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+#include "util/process.hpp"
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+
+TEST(ProcessTest, CapturesOutputAndExitCode) {
+    scaffolder::ProcessResult r = scaffolder::run_process({"sh", "-c", "echo out; echo err >&2; exit 3"});
+    EXPECT_EQ(r.exit_code, 3);
+    EXPECT_FALSE(r.ok());
+    EXPECT_EQ(r.out, "out\n");
+    EXPECT_EQ(r.err, "err\n");
+}
+
+TEST(ProcessTest, PassesArgumentsVerbatim) {
+    // No shell in between: spaces, quotes and globs arrive as written.
+    scaffolder::ProcessResult r = scaffolder::run_process({"printf", "%s|", "a b", "\"q\"", "*", "$HOME"});
+    EXPECT_TRUE(r.ok());
+    EXPECT_EQ(r.out, "a b|\"q\"|*|$HOME|");
+}
+
+TEST(ProcessTest, AddsAndReplacesEnvironmentVariables) {
+    scaffolder::ProcessResult r =
+        scaffolder::run_process({"sh", "-c", "echo \"$CMAKEGEN_TEST_VAR:$HOME\""}, {"CMAKEGEN_TEST_VAR=set", "HOME=/nowhere"});
+    EXPECT_EQ(r.out, "set:/nowhere\n");
+}
+
+TEST(ProcessTest, MissingProgramReports127) {
+    scaffolder::ProcessResult r = scaffolder::run_process({"cmakegen-no-such-program"});
+    EXPECT_EQ(r.exit_code, 127);
+}
+
+TEST(ProcessTest, ConcurrentCallsDoNotShareOutput) {
+    std::vector<std::string> outputs(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        threads.emplace_back([&outputs, i] {
+            outputs[i] = scaffolder::run_process({"sh", "-c", "sleep 0.05; echo " + std::to_string(i)}).out;
+        });
+    }
+    for (auto& t : threads) t.join();
+    for (size_t i = 0; i < outputs.size(); ++i) EXPECT_EQ(outputs[i], std::to_string(i) + "\n");
+}
+
+#endif
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include "util/run_journal.hpp"
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+class RunJournalTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = fs::temp_directory_path() / "cmakegen_run_journal_test";
+        fs::remove_all(dir_);
+    }
+    void TearDown() override { fs::remove_all(dir_); }
+
+    fs::path dir_;
+};
+
+TEST_F(RunJournalTest, ResumeSeesRecordsWithSameFingerprint) {
+    {
+        scaffolder::RunJournal journal(dir_, false);
+        journal.mark_done("copy", "hal", "aaa");
+        journal.mark_done("stage", "presets", "bbb");
+    }
+    scaffolder::RunJournal resumed(dir_, true);
+    EXPECT_TRUE(resumed.is_done("copy", "hal", "aaa"));
+    EXPECT_FALSE(resumed.is_done("copy", "hal", "changed"));
+    EXPECT_FALSE(resumed.is_done("copy", "uart", "aaa"));
+    EXPECT_TRUE(resumed.is_done("stage", "presets", "bbb"));
+
+    scaffolder::RunJournal fresh(dir_, false);
+    EXPECT_FALSE(fresh.is_done("copy", "hal", "aaa"));
+}
+
+TEST_F(RunJournalTest, TornLastLineIsIgnoredAndNotJoinedWithNextRecord) {
+    {
+        scaffolder::RunJournal journal(dir_, false);
+        journal.mark_done("copy", "hal", "aaa");
+    }
+    {
+        std::ofstream out(dir_ / scaffolder::RunJournal::kFileName, std::ios::app);
+        out << "{\"kind\": \"copy\", \"na";
+    }
+    {
+        scaffolder::RunJournal journal(dir_, true);
+        EXPECT_TRUE(journal.is_done("copy", "hal", "aaa"));
+        journal.mark_done("copy", "uart", "ccc");
+    }
+    scaffolder::RunJournal resumed(dir_, true);
+    EXPECT_TRUE(resumed.is_done("copy", "uart", "ccc"));
+}
+
+TEST_F(RunJournalTest, DryRunJournalWritesNothing) {
+    scaffolder::RunJournal journal(dir_, false, false);
+    journal.mark_done("copy", "hal", "aaa");
+    EXPECT_FALSE(fs::exists(dir_ / scaffolder::RunJournal::kFileName));
+}
+
+TEST_F(RunJournalTest, TreeFingerprintFollowsContent) {
+    fs::create_directories(dir_ / "meta/sub");
+    std::ofstream(dir_ / "meta/a.json") << "{}";
+    std::ofstream(dir_ / "meta/sub/b.json") << "[]";
+    std::string first = scaffolder::fingerprint_tree(dir_ / "meta");
+    EXPECT_EQ(first, scaffolder::fingerprint_tree(dir_ / "meta"));
+    std::ofstream(dir_ / "meta/sub/b.json") << "[1]";
+    EXPECT_NE(first, scaffolder::fingerprint_tree(dir_ / "meta"));
+}
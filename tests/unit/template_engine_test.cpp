@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+#include "generator/render_cache.hpp"
+#include "generator/template_engine.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static void write_file(const fs::path& p, const std::string& content) {
+    fs::create_directories(p.parent_path());
+    std::ofstream f(p, std::ios::binary);
+    f << content;
+}
+
+class TemplateEngineTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = fs::temp_directory_path() / "cmakegen_template_engine_test";
+        fs::remove_all(dir_);
+        write_file(dir_ / "hello.jinja2", "hello {{ name }}");
+    }
+
+    void TearDown() override { fs::remove_all(dir_); }
+
+    fs::path dir_;
+};
+
+TEST_F(TemplateEngineTest, ReusesParsedTemplateUntilMtimeChanges) {
+    scaffolder::TemplateEngine engine(dir_);
+    EXPECT_EQ(engine.render("hello.jinja2", {{"name", "uart"}}), "hello uart");
+
+    // Same mtime: the parsed template is reused and the file is not read again.
+    auto mtime = fs::last_write_time(dir_ / "hello.jinja2");
+    write_file(dir_ / "hello.jinja2", "bye {{ name }}");
+    fs::last_write_time(dir_ / "hello.jinja2", mtime);
+    EXPECT_EQ(engine.render("hello.jinja2", {{"name", "spi"}}), "hello spi");
+
+    fs::last_write_time(dir_ / "hello.jinja2", mtime + std::chrono::seconds(1));
+    EXPECT_EQ(engine.render("hello.jinja2", {{"name", "spi"}}), "bye spi");
+}
+
+TEST_F(TemplateEngineTest, ReportsMissingAndBrokenTemplates) {
+    scaffolder::TemplateEngine engine(dir_);
+    EXPECT_THROW(engine.render("missing.jinja2", {}), std::runtime_error);
+    write_file(dir_ / "broken.jinja2", "{% for x in %}");
+    try {
+        engine.render("broken.jinja2", {});
+        FAIL() << "expected a parse error";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find("broken.jinja2"), std::string::npos);
+    }
+}
+
+TEST_F(TemplateEngineTest, BuiltInTemplatesNeedNoDirectory) {
+    scaffolder::TemplateEngine engine{fs::path()};
+    EXPECT_TRUE(engine.templates_dir().empty());
+    EXPECT_NE(engine.render("cmake/AddHierarchicalLibrary.cmake", {}).find("add_hierarchical_library"), std::string::npos);
+    EXPECT_THROW(engine.render("missing.jinja2", {}), std::runtime_error);
+}
+
+TEST_F(TemplateEngineTest, OverrideDirectoryReplacesSingleTemplates) {
+    scaffolder::TemplateEngine builtin{fs::path()};
+    scaffolder::TemplateEngine engine(dir_);
+    write_file(dir_ / "cmake/AddHierarchicalLibrary.cmake", "# custom");
+    EXPECT_EQ(engine.render("cmake/AddHierarchicalLibrary.cmake", {}), "# custom");
+    EXPECT_EQ(engine.render("hello.jinja2", {{"name", "uart"}}), "hello uart");
+    EXPECT_NE(engine.fingerprint(), builtin.fingerprint());
+
+    // Removing the override falls back to the built-in template.
+    fs::remove(dir_ / "cmake/AddHierarchicalLibrary.cmake");
+    EXPECT_EQ(engine.render("cmake/AddHierarchicalLibrary.cmake", {}),
+              builtin.render("cmake/AddHierarchicalLibrary.cmake", {}));
+}
+
+TEST_F(TemplateEngineTest, ConcurrentRendersShareOneEngine) {
+    scaffolder::TemplateEngine engine(dir_);
+    std::vector<std::string> results(16);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < results.size(); ++i) {
+        threads.emplace_back([&, i] { results[i] = engine.render("hello.jinja2", {{"name", std::to_string(i)}}); });
+    }
+    for (auto& t : threads) t.join();
+    for (size_t i = 0; i < results.size(); ++i) EXPECT_EQ(results[i], "hello " + std::to_string(i));
+}
+
+static std::string read_file(const fs::path& p) {
+    std::ifstream f(p, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+TEST_F(TemplateEngineTest, RenderAllWritesSameFilesForAnyWorkerCount) {
+    scaffolder::TemplateEngine engine(dir_);
+    auto jobs_in = [&](const fs::path& out) {
+        std::vector<scaffolder::RenderJob> jobs;
+        for (int i = 0; i < 50; ++i) {
+            jobs.push_back({"hello.jinja2", {{"name", "c" + std::to_string(i)}},
+                            out / ("d" + std::to_string(i % 7)) / (std::to_string(i) + ".txt"), {}});
+        }
+        return jobs;
+    };
+    engine.render_all(jobs_in(dir_ / "serial"), 1);
+    engine.render_all(jobs_in(dir_ / "parallel"), 8);
+    for (const auto& job : jobs_in(dir_ / "serial")) {
+        fs::path rel = fs::relative(job.output_path, dir_ / "serial");
+        EXPECT_EQ(read_file(job.output_path), "hello " + job.data["name"].get<std::string>());
+        EXPECT_EQ(read_file(dir_ / "parallel" / rel), read_file(job.output_path));
+    }
+}
+
+TEST_F(TemplateEngineTest, RenderAllReportsFirstFailingJobInListOrder) {
+    write_file(dir_ / "broken.jinja2", "{% for x in %}");
+    scaffolder::TemplateEngine engine(dir_);
+    std::vector<scaffolder::RenderJob> jobs;
+    for (int i = 0; i < 20; ++i) jobs.push_back({"hello.jinja2", {{"name", "x"}}, dir_ / "out" / (std::to_string(i) + ".txt"), {}});
+    jobs[5].template_name = "missing.jinja2";
+    jobs[12].template_name = "broken.jinja2";
+    try {
+        engine.render_all(jobs, 4);
+        FAIL() << "expected an error";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find("missing.jinja2"), std::string::npos);
+    }
+    // The other jobs still ran.
+    EXPECT_TRUE(fs::exists(dir_ / "out" / "19.txt"));
+}
+
+TEST_F(TemplateEngineTest, RenderToFileRewritesOnlyChangedFiles) {
+    scaffolder::TemplateEngine engine(dir_);
+    fs::path out = dir_ / "out" / "CMakeLists.txt";
+    engine.render_to_file("hello.jinja2", {{"name", "uart"}}, out);
+    auto old_time = fs::last_write_time(out) - std::chrono::hours(1);
+    fs::last_write_time(out, old_time);
+
+    engine.render_to_file("hello.jinja2", {{"name", "uart"}}, out);
+    EXPECT_EQ(fs::last_write_time(out), old_time);
+
+    engine.render_to_file("hello.jinja2", {{"name", "spi"}}, out);
+    EXPECT_EQ(read_file(out), "hello spi");
+    EXPECT_NE(fs::last_write_time(out), old_time);
+    EXPECT_EQ(std::distance(fs::directory_iterator(out.parent_path()), fs::directory_iterator()), 1);
+
+    scaffolder::WriteStats stats = engine.write_stats();
+    EXPECT_EQ(stats.created, 1u);
+    EXPECT_EQ(stats.unchanged, 1u);
+    EXPECT_EQ(stats.changed, 1u);
+}
+
+TEST_F(TemplateEngineTest, RenderCacheServesRendersWithKnownInputs) {
+    auto cache = std::make_shared<scaffolder::RenderCache>(dir_ / "renders");
+    fs::path out = dir_ / "out" / "a.txt";
+    {
+        scaffolder::TemplateEngine engine(dir_);
+        engine.set_render_cache(cache);
+        engine.render_to_file("hello.jinja2", {{"name", "uart"}}, out);
+        EXPECT_EQ(engine.write_stats().cached, 0u);
+    }
+    // Replace the output in the one stored entry, keeping its inputs, so a hit shows in the output.
+    std::vector<fs::path> entries;
+    for (const auto& e : fs::recursive_directory_iterator(cache->root())) {
+        if (e.is_regular_file()) entries.push_back(e.path());
+    }
+    ASSERT_EQ(entries.size(), 1u);
+    std::string entry = read_file(entries[0]);
+    ASSERT_EQ(entry.substr(entry.size() - 10), "hello uart");
+    write_file(entries[0], entry.substr(0, entry.size() - 10) + "from cache");
+
+    scaffolder::TemplateEngine engine(dir_);
+    engine.set_render_cache(cache);
+    engine.render_to_file("hello.jinja2", {{"name", "uart"}}, dir_ / "out" / "b.txt");
+    EXPECT_EQ(read_file(dir_ / "out" / "b.txt"), "from cache");
+    EXPECT_EQ(engine.write_stats().cached, 1u);
+
+    // Other data or another template source is another key.
+    engine.render_to_file("hello.jinja2", {{"name", "spi"}}, dir_ / "out" / "c.txt");
+    EXPECT_EQ(read_file(dir_ / "out" / "c.txt"), "hello spi");
+    write_file(dir_ / "hello.jinja2", "bye {{ name }}");
+    fs::last_write_time(dir_ / "hello.jinja2", fs::last_write_time(dir_ / "hello.jinja2") + std::chrono::seconds(1));
+    engine.render_to_file("hello.jinja2", {{"name", "uart"}}, dir_ / "out" / "d.txt");
+    EXPECT_EQ(read_file(dir_ / "out" / "d.txt"), "bye uart");
+    EXPECT_EQ(engine.write_stats().cached, 1u);
+}
+
+TEST_F(TemplateEngineTest, RenderCacheMissesOnKeyCollision) {
+    scaffolder::RenderCache cache(dir_ / "renders");
+    cache.store("ab01", "template a, data 1", "a1");
+    EXPECT_EQ(cache.find("ab01", "template a, data 1"), std::optional<std::string>("a1"));
+    // Same key, other inputs: never another render's output.
+    EXPECT_FALSE(cache.find("ab01", "template b, data 2"));
+    EXPECT_FALSE(cache.find("ab01", "template a, data"));
+}
+
+TEST_F(TemplateEngineTest, RenderCachePruneRemovesUnusedEntries) {
+    scaffolder::RenderCache cache(dir_ / "renders");
+    cache.store("ab01", "in", "old");
+    cache.store("ab02", "in", "used");
+    cache.store("cd03", "in", "old");
+    auto stale = fs::file_time_type::clock::now() - std::chrono::hours(48);
+    fs::last_write_time(dir_ / "renders" / "ab" / "ab01", stale);
+    fs::last_write_time(dir_ / "renders" / "ab" / "ab02", stale);
+    fs::last_write_time(dir_ / "renders" / "cd" / "cd03", stale);
+    EXPECT_EQ(cache.find("ab02", "in"), std::optional<std::string>("used"));  // a hit counts as a use
+
+    EXPECT_EQ(cache.prune(std::chrono::hours(24)), 2u);
+    EXPECT_FALSE(cache.find("ab01", "in"));
+    EXPECT_TRUE(cache.find("ab02", "in"));
+    EXPECT_FALSE(fs::exists(dir_ / "renders" / "cd"));
+
+    EXPECT_EQ(cache.prune(std::chrono::hours(0)), 1u);
+    EXPECT_FALSE(cache.find("ab02", "in"));
+}
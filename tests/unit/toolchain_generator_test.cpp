@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include "generator/preset_generator.hpp"
+#include "generator/toolchain_generator.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace fs = std::filesystem;
+
+static std::string read_file(const fs::path& p) {
+    std::ifstream f(p, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+static std::string c_flags_line(const fs::path& toolchain_file) {
+    std::string content = read_file(toolchain_file);
+    size_t begin = content.find("set(CMAKE_C_FLAGS ");
+    if (begin == std::string::npos) return "";
+    return content.substr(begin, content.find('\n', begin) - begin);
+}
+
+class ToolchainGeneratorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = fs::temp_directory_path() / "cmakegen_toolchain_generator_test";
+        fs::remove_all(dir_);
+
+        scaffolder::Toolchain arm;
+        arm.id = "arm";
+        arm.compiler = {"arm-none-eabi-gcc", "arm-none-eabi-g++", "arm-none-eabi-gcc"};
+        arm.flags = {{"c", {"-mthumb", "-Os"}}};
+        scaffolder::Toolchain riscv;
+        riscv.id = "riscv";
+        riscv.compiler = {"riscv-gcc", "riscv-g++", "riscv-gcc"};
+        riscv.flags = {{"c", {"-Os"}}};
+        meta_.toolchains = {arm, riscv};
+    }
+
+    void TearDown() override { fs::remove_all(dir_); }
+
+    void generate() {
+        scaffolder::MetadataIndex index(meta_);
+        scaffolder::ToolchainGenerator(index).generate_all(dir_);
+    }
+
+    static scaffolder::BuildVariant variant(const std::string& id) {
+        scaffolder::BuildVariant bv;
+        bv.id = id;
+        return bv;
+    }
+
+    scaffolder::Metadata meta_;
+    fs::path dir_;
+};
+
+TEST_F(ToolchainGeneratorTest, VariantWithoutInheritanceMergesOverToolchainBase) {
+    auto debug = variant("debug");
+    debug.flags = {{"c", {"-g"}}};
+    debug.remove_flags = {{"c", {"-Os"}}};
+    debug.add_flags = {{"riscv", {{"c", {"-Og"}}}}};
+    meta_.build_variants = {debug};
+    generate();
+    EXPECT_EQ(c_flags_line(dir_ / "toolchains" / "arm-debug.cmake"), "set(CMAKE_C_FLAGS \"-mthumb -g \")");
+    EXPECT_EQ(c_flags_line(dir_ / "toolchains" / "riscv-debug.cmake"), "set(CMAKE_C_FLAGS \"-Og \")");
+}
+
+TEST_F(ToolchainGeneratorTest, InheritingVariantAppliesItsFlagsAfterItsParents) {
+    auto base = variant("base");
+    base.flags = {{"c", {"-g", "-ffunction-sections"}}};
+    base.remove_flags = {{"c", {"-Os"}}};
+    auto release = variant("release");
+    release.inherits = "opt";
+    release.remove_flags = {{"c", {"-g"}}};
+    release.add_flags = {{"riscv", {{"c", {"-O3"}}}}};
+    auto opt = variant("opt");
+    opt.inherits = "base";
+    opt.flags = {{"c", {"-O2"}}};
+    // Listed before the variant it inherits; the chain is resolved in inheritance order anyway.
+    meta_.build_variants = {release, opt, base};
+    generate();
+
+    EXPECT_EQ(c_flags_line(dir_ / "toolchains" / "arm-base.cmake"), "set(CMAKE_C_FLAGS \"-mthumb -g -ffunction-sections \")");
+    EXPECT_EQ(c_flags_line(dir_ / "toolchains" / "arm-opt.cmake"),
+              "set(CMAKE_C_FLAGS \"-mthumb -g -ffunction-sections -O2 \")");
+    // release removes the inherited -g and adds nothing of its own for arm.
+    EXPECT_EQ(c_flags_line(dir_ / "toolchains" / "arm-release.cmake"),
+              "set(CMAKE_C_FLAGS \"-mthumb -ffunction-sections -O2 \")");
+    EXPECT_EQ(c_flags_line(dir_ / "toolchains" / "riscv-release.cmake"),
+              "set(CMAKE_C_FLAGS \"-ffunction-sections -O2 -O3 \")");
+}
+
+TEST_F(ToolchainGeneratorTest, ReferencedFilesSkipUnusedAndShareIdenticalContents) {
+    meta_.socs = {{"h7", "H7", "", {"cortex-m7"}}};
+    meta_.boards = {{"nucleo", "Nucleo", {"h7"}, {}}};
+    meta_.isa_variants = {{"cortex-m7", "arm", "M7"}};
+    meta_.preset_matrix.binary_dir_pattern = "build/${preset}";
+    auto debug = variant("debug");
+    debug.flags = {{"c", {"-g"}}};
+    auto release = variant("release");
+    release.flags = {{"c", {"-O2"}}};
+    auto fast = variant("fast");
+    fast.flags = {{"c", {"-O2"}}};
+    meta_.build_variants = {debug, release, fast};
+    scaffolder::PresetExclude no_debug;
+    no_debug.build_variant = "debug";
+    meta_.preset_matrix.exclude = {no_debug};
+
+    scaffolder::MetadataIndex index(meta_);
+    scaffolder::ToolchainGenerator toolchain_gen(index);
+    scaffolder::PresetGenerator preset_gen(index);
+    scaffolder::ToolchainFiles files = toolchain_gen.referenced_files(preset_gen.compute_combinations());
+    scaffolder::ToolchainFiles expected = {{{"arm", "release"}, "arm-release.cmake"},
+                                           {{"arm", "fast"}, "arm-release.cmake"}};
+    EXPECT_EQ(files, expected);
+
+    toolchain_gen.generate(dir_, files);
+    preset_gen.generate(dir_, &files);
+    std::vector<std::string> written;
+    for (const auto& e : fs::directory_iterator(dir_ / "toolchains")) written.push_back(e.path().filename().string());
+    EXPECT_EQ(written, std::vector<std::string>{"arm-release.cmake"});
+    std::string presets = read_file(dir_ / "CMakePresets.json");
+    EXPECT_NE(presets.find("nucleo_h7_cortex-m7_fast"), std::string::npos);
+    EXPECT_EQ(presets.find("arm-fast.cmake"), std::string::npos);
+    EXPECT_EQ(presets.find("arm-debug.cmake"), std::string::npos);
+}
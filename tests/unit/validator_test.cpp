@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include "metadata/validator.hpp"
+#include <thread>
+#include <vector>
+
+static scaffolder::SwComponent component(const std::string& id, const std::string& type) {
+    scaffolder::SwComponent c;
+    c.id = id;
+    c.type = type;
+    c.source = id;
+    return c;
+}
+
+static scaffolder::Metadata valid_metadata() {
+    scaffolder::Metadata meta;
+    meta.project = {"demo", "1.0", {}};
+    meta.preset_matrix.dimensions = {"board"};
+    meta.socs = {{"h7", "H7", "", {"cortex-m7"}}};
+    meta.boards = {{"nucleo", "Nucleo", {"h7"}, {}}};
+    scaffolder::Toolchain arm;
+    arm.id = "arm";
+    meta.toolchains = {arm};
+    meta.isa_variants = {{"cortex-m7", "arm", "M7"}};
+    scaffolder::BuildVariant debug;
+    debug.id = "debug";
+    meta.build_variants = {debug};
+    meta.source_tree.components = {component("hal", "library"), component("app", "executable")};
+    meta.source_tree.components[1].dependencies = std::vector<std::string>{"hal"};
+    return meta;
+}
+
+// One error in every check group, plus a repeated component id.
+static scaffolder::Metadata broken_metadata() {
+    scaffolder::Metadata meta = valid_metadata();
+    meta.project.version.clear();
+    meta.source_tree.components.push_back(component("hal", "library"));
+    meta.source_tree.components[1].dependencies->push_back("fmt");
+    meta.boards[0].socs.push_back("rv");
+    meta.isa_variants[0].toolchain = "gcc";
+    scaffolder::PresetExclude ex;
+    ex.build_variant = "release";
+    meta.preset_matrix.exclude = {ex};
+    meta.build_variants[0].inherits = "base";
+    return meta;
+}
+
+TEST(ValidatorTest, AcceptsValidMetadata) {
+    scaffolder::Validator validator;
+    EXPECT_NO_THROW(validator.validate(valid_metadata()));
+    EXPECT_TRUE(validator.errors().empty());
+}
+
+TEST(ValidatorTest, ReportsFieldAndReferenceErrorsInOnePass) {
+    scaffolder::Validator validator;
+    EXPECT_THROW(validator.validate(broken_metadata()), scaffolder::ValidationError);
+    std::vector<std::string> expected = {
+        "project.version is required",
+        "duplicate component id: hal",
+        "component app depends on unknown fmt",
+        "ISA variant 'cortex-m7' references toolchain 'gcc' which does not exist.",
+        "Board 'nucleo' references SOC 'rv' which does not exist.",
+        "Preset exclude references build_variant 'release' which does not exist.",
+        "Build variant 'debug' inherits 'base' which does not exist.",
+    };
+    EXPECT_EQ(validator.errors(), expected);
+}
+
+TEST(ValidatorTest, SameErrorsForAnyWorkerCountAndConcurrentValidators) {
+    scaffolder::Metadata meta = broken_metadata();
+    scaffolder::Validator serial;
+    EXPECT_THROW(serial.validate(meta), scaffolder::ValidationError);
+
+    std::vector<scaffolder::Validator> validators(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < validators.size(); ++i) {
+        threads.emplace_back([&, i] {
+            try {
+                validators[i].validate(meta, static_cast<unsigned>(i % 2 ? 0 : 3));
+            } catch (const scaffolder::ValidationError&) {
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    for (const auto& v : validators) EXPECT_EQ(v.errors(), serial.errors());
+}
+
+TEST(ValidatorTest, ReportsDependencyAndInheritanceCycles) {
+    scaffolder::Metadata meta = valid_metadata();
+    meta.source_tree.components[0].dependencies = std::vector<std::string>{"app"};
+    meta.source_tree.components.push_back(component("loop", "library"));
+    meta.source_tree.components.back().dependencies = std::vector<std::string>{"loop"};
+    meta.build_variants[0].inherits = "debug";
+
+    scaffolder::Validator validator;
+    EXPECT_THROW(validator.validate(meta), scaffolder::ValidationError);
+    std::vector<std::string> expected = {
+        "dependency cycle between components hal, app",
+        "component loop depends on itself",
+        "Build variant 'debug' inherits itself.",
+    };
+    EXPECT_EQ(validator.errors(), expected);
+}